@@ -1,3 +1,8 @@
+#include <cstddef>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "arraycollections.h"
 #include "queue.h"
 #include "stack.h"
 #include "SimpleTest.h"
@@ -48,6 +53,43 @@ int sumStack(Stack<int> s) {
     return total;
 }
 
+/* These versions do the same work on the array-backed containers, using
+ * their bulk operations instead of moving one element at a time.
+ */
+void reverse(RingQueue<int>& q) {
+    q.reverse();
+}
+
+void duplicateNegatives(RingQueue<int>& q) {
+    q.duplicateIf([](int val) { return val < 0; });
+}
+
+/* Sums count ints starting at values, four lanes at a time where SSE2 is
+ * available. Like the loop in sumStack, the total wraps on overflow.
+ */
+static int sumInts(const int* values, size_t count) {
+    size_t i = 0;
+    unsigned total = 0;
+#if defined(__SSE2__)
+    __m128i lanes = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        lanes = _mm_add_epi32(lanes, _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)));
+    }
+    alignas(16) unsigned partial[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(partial), lanes);
+    total = partial[0] + partial[1] + partial[2] + partial[3];
+#endif
+    for (; i < count; i++) {
+        total += unsigned(values[i]);
+    }
+    return int(total);
+}
+
+/* Reads the stack through its read-only view, so nothing is copied or popped. */
+int sumStack(const ArrayStack<int>& s) {
+    return sumInts(s.begin(), s.end() - s.begin());
+}
+
 STUDENT_TEST("duplicateNegatives, input has repeated negative numbers")
 {
     Queue<int> q = {-1, -1};
@@ -120,3 +162,58 @@ PROVIDED_TEST("sumStack, empty stack") {
 
     EXPECT_EQUAL(sumStack(empty), 0);
 }
+
+STUDENT_TEST("RingQueue versions match the Queue versions, including after wraparound") {
+    RingQueue<int> q = {1, 2, 3, 4, 5};
+    RingQueue<int> expected = {5, 4, 3, 2, 1};
+    reverse(q);
+    EXPECT_EQUAL(q, expected);
+
+    RingQueue<int> wrapped;
+    for (int i = 0; i < 6; i++) wrapped.enqueue(i);
+    for (int i = 0; i < 6; i++) wrapped.dequeue();
+    for (int val : {-3, 4, -5, 10, 7, -1}) wrapped.enqueue(val);   // wraps past the end of 8 slots
+    RingQueue<int> doubled = {-3, -3, 4, -5, -5, 10, 7, -1, -1};
+    duplicateNegatives(wrapped);
+    EXPECT_EQUAL(wrapped, doubled);
+
+    RingQueue<int> none = {2, 10};
+    duplicateNegatives(none);
+    EXPECT_EQUAL(none.size(), 2);
+    EXPECT_ERROR(RingQueue<int>().dequeue());
+}
+
+STUDENT_TEST("sumStack on an ArrayStack, including sizes that don't fill a SIMD lane") {
+    ArrayStack<int> s = {1, 8, -5};
+    EXPECT_EQUAL(sumStack(s), 4);
+    EXPECT_EQUAL(s.size(), 3);
+    EXPECT_EQUAL(sumStack(ArrayStack<int>()), 0);
+
+    ArrayStack<int> many;
+    for (int i = 1; i <= 1001; i++) many.push(i);
+    EXPECT_EQUAL(sumStack(many), 1001 * 1002 / 2);
+    EXPECT_EQUAL(many.pop(), 1001);
+}
+
+STUDENT_TEST("Time reverse, duplicateNegatives and sumStack at 10^7 elements, library vs array-backed") {
+    const int n = 10000000;
+    Queue<int> q;
+    RingQueue<int> ring;
+    Stack<int> s;
+    ArrayStack<int> arrayStack;
+    for (int i = 0; i < n; i++) {
+        int val = (i % 3 == 0) ? -i : i;
+        q.enqueue(val);
+        ring.enqueue(val);
+        s.push(val);
+        arrayStack.push(val);
+    }
+    TIME_OPERATION(n, reverse(q));
+    TIME_OPERATION(n, reverse(ring));
+    TIME_OPERATION(n, duplicateNegatives(q));
+    TIME_OPERATION(n, duplicateNegatives(ring));
+    EXPECT_EQUAL(q.size(), ring.size());
+    TIME_OPERATION(n, sumStack(s));
+    TIME_OPERATION(n, sumStack(arrayStack));
+    EXPECT_EQUAL(sumStack(s), sumStack(arrayStack));
+}
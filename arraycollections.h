@@ -0,0 +1,242 @@
+/*
+ * File: arraycollections.h
+ * ------------------------
+ * Defines RingQueue and ArrayStack, contiguous alternatives to the library
+ * Queue and Stack for hot loops. Elements live in one array instead of
+ * separately allocated nodes. Elements are moved out on dequeue and pop
+ * rather than copied. Both classes are move-only, so passing one by
+ * value without meaning to is a compile error instead of a silent copy.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "error.h"
+
+/*
+ * The RingQueue class is a first-in/first-out queue stored in a circular
+ * array whose capacity is a power of two. It doubles when it fills up, so
+ * enqueue is amortized O(1). reverse and duplicateIf rearrange the queue
+ * in place, without pushing each element back through enqueue/dequeue.
+ */
+template <typename T>
+class RingQueue {
+public:
+    RingQueue() : _head(0), _size(0) {}
+
+    RingQueue(std::initializer_list<T> values) : RingQueue() {
+        reserve(values.size());
+        for (const T& value : values) enqueue(value);
+    }
+
+    RingQueue(RingQueue&& other) = default;
+    RingQueue& operator=(RingQueue&& other) = default;
+    RingQueue(const RingQueue&) = delete;
+    RingQueue& operator=(const RingQueue&) = delete;
+
+    bool isEmpty() const {
+        return _size == 0;
+    }
+
+    int size() const {
+        return int(_size);
+    }
+
+    /* Makes room for at least n elements without further allocation. */
+    void reserve(size_t n) {
+        if (n > _slots.size()) regrow(n);
+    }
+
+    void enqueue(T value) {
+        if (_size == _slots.size()) regrow(_size + 1);
+        _slots[(_head + _size) & (_slots.size() - 1)] = std::move(value);
+        _size++;
+    }
+
+    T dequeue() {
+        if (_size == 0) error("RingQueue::dequeue: Attempting to dequeue an empty queue");
+        T value = std::move(_slots[_head]);
+        _head = (_head + 1) & (_slots.size() - 1);
+        _size--;
+        return value;
+    }
+
+    T& peek() {
+        if (_size == 0) error("RingQueue::peek: Attempting to peek at an empty queue");
+        return _slots[_head];
+    }
+
+    /* Returns the element i places from the front. */
+    const T& operator[](int i) const {
+        return _slots[(_head + i) & (_slots.size() - 1)];
+    }
+
+    void clear() {
+        _head = _size = 0;
+    }
+
+    /* Reverses the order of the elements in place. */
+    void reverse() {
+        for (size_t i = 0, j = _size; i + 1 < j; i++, j--) {
+            std::swap(at(i), at(j - 1));
+        }
+    }
+
+    /*
+     * Inserts a second copy of every element for which keep returns true,
+     * directly after the original. Makes one backward pass over the array,
+     * moving each element at most once and stopping at the first kept one.
+     */
+    template <typename Predicate>
+    void duplicateIf(Predicate keep) {
+        size_t extra = 0;
+        for (size_t i = 0; i < _size; i++) {
+            if (keep(at(i))) extra++;
+        }
+        if (extra == 0) return;
+        if (_head + _size + extra > _slots.size()) regrow(_size + extra);
+        size_t from = _head + _size;
+        size_t to = from + extra;
+        while (to > from) {    // elements before the last kept one stay put
+            from--;
+            bool twice = keep(_slots[from]);
+            _slots[--to] = std::move(_slots[from]);
+            if (twice) {
+                _slots[to - 1] = _slots[to];
+                --to;
+            }
+        }
+        _size += extra;
+    }
+
+    bool operator==(const RingQueue& other) const {
+        if (_size != other._size) return false;
+        for (size_t i = 0; i < _size; i++) {
+            if (!(at(i) == other.at(i))) return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const RingQueue& other) const {
+        return !(*this == other);
+    }
+
+private:
+    T& at(size_t i) {
+        return _slots[(_head + i) & (_slots.size() - 1)];
+    }
+
+    const T& at(size_t i) const {
+        return _slots[(_head + i) & (_slots.size() - 1)];
+    }
+
+    /* Moves the elements into a new array of at least n slots, starting at index 0. */
+    void regrow(size_t n) {
+        size_t capacity = 8;
+        while (capacity < n) capacity *= 2;
+        std::vector<T> slots(capacity);
+        for (size_t i = 0; i < _size; i++) {
+            slots[i] = std::move(at(i));
+        }
+        _slots.swap(slots);
+        _head = 0;
+    }
+
+    std::vector<T> _slots;   // size is zero or a power of two
+    size_t _head;
+    size_t _size;
+};
+
+template <typename T>
+std::ostream& operator<<(std::ostream& out, const RingQueue<T>& queue) {
+    out << "{";
+    for (int i = 0; i < queue.size(); i++) {
+        if (i > 0) out << ", ";
+        out << queue[i];
+    }
+    return out << "}";
+}
+
+/*
+ * The ArrayStack class is a last-in/first-out stack stored in a vector,
+ * bottom element first. begin/end give a read-only view of the elements in
+ * that order for passes that don't need to pop them.
+ */
+template <typename T>
+class ArrayStack {
+public:
+    ArrayStack() {}
+
+    ArrayStack(std::initializer_list<T> values) : _elems(values) {}
+
+    ArrayStack(ArrayStack&& other) = default;
+    ArrayStack& operator=(ArrayStack&& other) = default;
+    ArrayStack(const ArrayStack&) = delete;
+    ArrayStack& operator=(const ArrayStack&) = delete;
+
+    bool isEmpty() const {
+        return _elems.empty();
+    }
+
+    int size() const {
+        return int(_elems.size());
+    }
+
+    void reserve(size_t n) {
+        _elems.reserve(n);
+    }
+
+    void push(T value) {
+        _elems.push_back(std::move(value));
+    }
+
+    T pop() {
+        if (_elems.empty()) error("ArrayStack::pop: Attempting to pop an empty stack");
+        T value = std::move(_elems.back());
+        _elems.pop_back();
+        return value;
+    }
+
+    T& peek() {
+        if (_elems.empty()) error("ArrayStack::peek: Attempting to peek at an empty stack");
+        return _elems.back();
+    }
+
+    void clear() {
+        _elems.clear();
+    }
+
+    const T* begin() const {
+        return _elems.data();
+    }
+
+    const T* end() const {
+        return _elems.data() + _elems.size();
+    }
+
+    bool operator==(const ArrayStack& other) const {
+        return _elems == other._elems;
+    }
+
+    bool operator!=(const ArrayStack& other) const {
+        return _elems != other._elems;
+    }
+
+private:
+    std::vector<T> _elems;
+};
+
+template <typename T>
+std::ostream& operator<<(std::ostream& out, const ArrayStack<T>& stack) {
+    out << "{";
+    for (const T* p = stack.begin(); p != stack.end(); ++p) {
+        if (p != stack.begin()) out << ", ";
+        out << *p;
+    }
+    return out << "}";
+}
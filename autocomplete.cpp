@@ -0,0 +1,335 @@
+/*
+ * File: autocomplete.cpp
+ * ----------------------
+ * The completion trie. A full build inserts every term and then computes
+ * each node's best terms from its own term and its children's lists, in
+ * decreasing node number. Those lists are sized exactly. An update that
+ * needs more room than a node has gives the node a fresh block of k slots
+ * at the end of _top; the old block is reclaimed by the next full build.
+ */
+#include <algorithm>
+#include <random>
+#include "autocomplete.h"
+#include "error.h"
+#include "map.h"
+#include "search.h"
+#include "set.h"
+#include "strlib.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+const long Autocompleter::kQueryLogBoost;
+
+Autocompleter::Autocompleter(int k) : _k(k) {
+    if (k < 1 || k > 255) {
+        error("Autocompleter: k must be from 1 to 255");
+    }
+    _nodes.resize(1);
+}
+
+int Autocompleter::findNode(const string& prefix) const {
+    int node = 0;
+    for (char ch : prefix) {
+        int child = _nodes[node].firstChild;
+        while (child >= 0 && (unsigned char) _nodes[child].ch < (unsigned char) ch) {
+            child = _nodes[child].nextSibling;
+        }
+        if (child < 0 || _nodes[child].ch != ch) return -1;
+        node = child;
+    }
+    return node;
+}
+
+/*
+ * Returns the number of term, adding it and any missing nodes if it is
+ * new. If path is not null, the nodes from the root to the term's node are
+ * appended to it.
+ */
+int Autocompleter::addTerm(const string& term, vector<int>* path) {
+    int node = 0;
+    if (path) path->push_back(0);
+    for (char ch : term) {
+        int prev = -1;
+        int child = _nodes[node].firstChild;
+        while (child >= 0 && (unsigned char) _nodes[child].ch < (unsigned char) ch) {
+            prev = child;
+            child = _nodes[child].nextSibling;
+        }
+        if (child < 0 || _nodes[child].ch != ch) {
+            int added = _nodes.size();
+            _nodes.emplace_back();
+            _nodes[added].ch = ch;
+            _nodes[added].nextSibling = child;
+            if (prev < 0) {
+                _nodes[node].firstChild = added;
+            } else {
+                _nodes[prev].nextSibling = added;
+            }
+            child = added;
+        }
+        node = child;
+        if (path) path->push_back(node);
+    }
+    if (_nodes[node].term < 0) {
+        _nodes[node].term = _terms.size();
+        _terms.push_back(term);
+        _docFreq.push_back(0);
+        _logWeight.push_back(0);
+    }
+    return _nodes[node].term;
+}
+
+long Autocompleter::termWeight(int term) const {
+    return _docFreq[term] > 0 ? _docFreq[term] + _logWeight[term] : 0;
+}
+
+/* Returns whether term a ranks before term b. */
+bool Autocompleter::heavier(int a, int b) const {
+    long wa = termWeight(a);
+    long wb = termWeight(b);
+    return wa != wb ? wa > wb : _terms[a] < _terms[b];
+}
+
+/*
+ * Recomputes the best terms of node from its own term and its children's
+ * lists, which are already up to date. With exact, a node that needs more
+ * room gets exactly as much as it needs; otherwise it gets k slots.
+ */
+void Autocompleter::recompute(int node, bool exact) {
+    Node& n = _nodes[node];
+    _candidates.clear();
+    if (n.term >= 0 && termWeight(n.term) > 0) _candidates.push_back(n.term);
+    for (int child = n.firstChild; child >= 0; child = _nodes[child].nextSibling) {
+        const Node& c = _nodes[child];
+        _candidates.insert(_candidates.end(), _top.begin() + c.topStart, _top.begin() + c.topStart + c.topCount);
+    }
+    auto byWeight = [this](int a, int b) { return heavier(a, b); };
+    int count = min<int>(_k, _candidates.size());
+    partial_sort(_candidates.begin(), _candidates.begin() + count, _candidates.end(), byWeight);
+
+    if (count > n.topCapacity) {
+        n.topCapacity = exact ? count : _k;
+        n.topStart = _top.size();
+        _top.resize(_top.size() + n.topCapacity);
+    }
+    copy(_candidates.begin(), _candidates.begin() + count, _top.begin() + n.topStart);
+    n.topCount = count;
+}
+
+/* Recomputes every node listed in dirty, children before parents. */
+void Autocompleter::refresh(vector<int>& dirty) {
+    sort(dirty.begin(), dirty.end(), greater<int>());
+    dirty.erase(unique(dirty.begin(), dirty.end()), dirty.end());
+    for (int node : dirty) {
+        recompute(node, false);
+    }
+}
+
+void Autocompleter::build(const Map<string, Set<string>>& index) {
+    Vector<string> terms;
+    Vector<long> docFreqs;
+    for (const string& term : index) {
+        terms.add(term);
+        docFreqs.add(index[term].size());
+    }
+    build(terms, docFreqs);
+}
+
+void Autocompleter::build(const Vector<string>& terms, const Vector<long>& docFreqs) {
+    _nodes.assign(1, Node());
+    _top.clear();
+    _terms.clear();
+    _docFreq.clear();
+    _logWeight.clear();
+    for (int i = 0; i < terms.size(); i++) {
+        int term = addTerm(terms[i], nullptr);
+        _docFreq[term] = docFreqs[i];
+    }
+    for (int node = _nodes.size() - 1; node >= 0; node--) {
+        recompute(node, true);
+    }
+}
+
+void Autocompleter::update(const Map<string, Set<string>>& index, const Set<string>& changedTerms) {
+    vector<int> dirty;
+    for (const string& term : changedTerms) {
+        long docFreq = index.containsKey(term) ? index[term].size() : 0;
+        if (docFreq == 0 && findNode(term) < 0) continue;   // never was a term, and still isn't
+        int id = addTerm(term, &dirty);
+        _docFreq[id] = docFreq;
+    }
+    refresh(dirty);
+}
+
+void Autocompleter::replayQueryLog(const Vector<string>& queries, const IndexOptions& options) {
+    vector<int> dirty;
+    for (const string& query : queries) {
+        for (const QueryTerm& queryTerm : parseQuery(query, options)) {
+            for (const string& key : queryTerm.keys) {
+                int node = findNode(key);
+                if (node < 0 || _nodes[node].term < 0 || _docFreq[_nodes[node].term] == 0) continue;
+                _logWeight[_nodes[node].term] += kQueryLogBoost;
+                addTerm(key, &dirty);   // only records the path
+            }
+        }
+    }
+    refresh(dirty);
+}
+
+Vector<string> Autocompleter::complete(const string& prefix) const {
+    Vector<string> completions;
+    int node = findNode(prefix);
+    if (node < 0) return completions;
+    const Node& n = _nodes[node];
+    for (int i = 0; i < n.topCount; i++) {
+        completions.add(_terms[_top[n.topStart + i]]);
+    }
+    return completions;
+}
+
+long Autocompleter::weight(const string& term) const {
+    int node = findNode(term);
+    return node < 0 || _nodes[node].term < 0 ? 0 : termWeight(_nodes[node].term);
+}
+
+int Autocompleter::numTerms() const {
+    int count = 0;
+    for (int term = 0; term < int(_terms.size()); term++) {
+        if (_docFreq[term] > 0) count++;
+    }
+    return count;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Returns the best k terms of weights starting with prefix, by checking every term. */
+static Vector<string> completeByScan(const Map<string, long>& weights, const string& prefix, int k) {
+    Vector<string> matches;
+    for (const string& term : weights) {
+        if (weights[term] > 0 && term.compare(0, prefix.size(), prefix) == 0) matches.add(term);
+    }
+    sort(matches.begin(), matches.end(), [&](const string& a, const string& b) {
+        return weights[a] != weights[b] ? weights[a] > weights[b] : a < b;
+    });
+    while (matches.size() > k) matches.remove(matches.size() - 1);
+    return matches;
+}
+
+STUDENT_TEST("complete ranks by page count, then alphabetically") {
+    Map<string, Set<string>> index;
+    index["cs106b"] = {"a", "b", "c"};
+    index["cs106l"] = {"a", "b"};
+    index["cs107"] = {"a", "b", "c", "d"};
+    index["cat"] = {"a"};
+    index["car"] = {"a"};
+    Autocompleter completer(3);
+    completer.build(index);
+    EXPECT_EQUAL(completer.complete("c"), {"cs107", "cs106b", "cs106l"});
+    EXPECT_EQUAL(completer.complete("ca"), {"car", "cat"});
+    EXPECT_EQUAL(completer.complete("cs106"), {"cs106b", "cs106l"});
+    EXPECT_EQUAL(completer.complete("cs107"), {"cs107"});
+    EXPECT_EQUAL(completer.complete("dog"), {});
+    EXPECT_EQUAL(completer.complete(""), {"cs107", "cs106b", "cs106l"});
+    EXPECT_EQUAL(completer.weight("cs106l"), 2);
+    EXPECT_EQUAL(completer.numTerms(), 5);
+    EXPECT_ERROR(Autocompleter(0));
+}
+
+STUDENT_TEST("Incremental updates and query log replay give the same answers as a full build") {
+    Map<string, Set<string>> index;
+    buildIndex("res/website.txt", index);
+    Autocompleter completer(5);
+    completer.build(index);
+
+    // Change the index: drop some terms, add some, and grow others
+    Set<string> changed = {"citation", "style", "cs106l", "zzznew", "template", "qt"};
+    index.remove("citation");
+    index.remove("qt");
+    index["zzznew"] = {"x", "y", "z"};
+    index["style"].add("www.example.com/extra");
+    index["template"] = {"only"};
+    completer.update(index, changed);
+
+    Vector<string> log = {"style +grading", "cs106l template -qt", "ctiation misspelled", "template"};
+    completer.replayQueryLog(log, IndexOptions());
+
+    Map<string, long> weights;
+    for (const string& term : index) weights[term] = index[term].size();
+    for (string term : {"style", "grading", "cs106l", "template", "template"}) weights[term] += Autocompleter::kQueryLogBoost;
+    Autocompleter fresh(5);
+    fresh.build(index);
+    fresh.replayQueryLog(log, IndexOptions());
+
+    EXPECT_EQUAL(completer.weight("citation"), 0);
+    EXPECT_EQUAL(completer.weight("ctiation"), 0);
+    EXPECT_EQUAL(completer.weight("template"), 1 + 2 * Autocompleter::kQueryLogBoost);
+    EXPECT_EQUAL(completer.numTerms(), index.size());
+    for (string prefix : {"", "c", "ci", "s", "st", "t", "te", "z", "q", "g", "cs1"}) {
+        EXPECT_EQUAL(completer.complete(prefix), completeByScan(weights, prefix, 5));
+        EXPECT_EQUAL(fresh.complete(prefix), completer.complete(prefix));
+    }
+}
+
+/* Returns a random term of 3 to 12 lowercase letters. */
+static string randomTerm(mt19937& random) {
+    string term(3 + random() % 10, ' ');
+    for (char& ch : term) ch = 'a' + random() % 26;
+    return term;
+}
+
+STUDENT_TEST("complete agrees with a full scan on random vocabularies") {
+    mt19937 random(106);
+    Vector<string> terms;
+    Vector<long> docFreqs;
+    Map<string, long> weights;
+    for (int i = 0; i < 5000; i++) {
+        string term = randomTerm(random).substr(0, 1 + random() % 5);
+        long docFreq = 1 + random() % 20;
+        terms.add(term);
+        docFreqs.add(docFreq);
+        weights[term] = docFreq;   // a repeated term keeps its last count
+    }
+    Autocompleter completer(8);
+    completer.build(terms, docFreqs);
+    EXPECT_EQUAL(completer.numTerms(), weights.size());
+    for (int i = 0; i < 300; i++) {
+        string prefix = randomTerm(random).substr(0, random() % 4);
+        EXPECT_EQUAL(completer.complete(prefix), completeByScan(weights, prefix, 8));
+    }
+}
+
+/* Completes every prefix in turn, returning false if any completion does not start with its prefix. */
+static bool completeAll(const Autocompleter& completer, const vector<string>& prefixes) {
+    bool allMatch = true;
+    for (const string& prefix : prefixes) {
+        for (const string& term : completer.complete(prefix)) {
+            allMatch = allMatch && startsWith(term, prefix);
+        }
+    }
+    return allMatch;
+}
+
+STUDENT_TEST("complete time per prefix on a million-term vocabulary") {
+    mt19937 random(106);
+    Vector<string> terms;
+    Vector<long> docFreqs;
+    for (int i = 0; i < 1000000; i++) {
+        terms.add(randomTerm(random));
+        docFreqs.add(1 + 1000000 / (1 + random() % 1000000));   // a few common terms, many rare ones
+    }
+    Autocompleter completer(10);
+    TIME_OPERATION(terms.size(), completer.build(terms, docFreqs));
+
+    vector<string> prefixes;
+    for (int i = 0; i < 200000; i++) {
+        const string& term = terms[random() % terms.size()];
+        prefixes.push_back(term.substr(0, 1 + random() % min<int>(term.size(), 6)));
+    }
+    bool allMatch = false;
+    TIME_OPERATION(prefixes.size(), allMatch = completeAll(completer, prefixes));
+    EXPECT(allMatch);
+    EXPECT_EQUAL(completer.complete(prefixes[0]).size() > 0, true);
+}
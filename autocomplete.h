@@ -0,0 +1,93 @@
+/*
+ * File: autocomplete.h
+ * --------------------
+ * Defines query autocompletion over an index's term dictionary. The terms
+ * are kept in a trie whose every node stores its k best completions,
+ * best first, so a lookup only walks the prefix and copies out at most k
+ * terms. That takes microseconds however many terms there are. A term's
+ * weight is the number of pages containing it, plus a boost for each time
+ * it was typed in a replayed query log.
+ *
+ * When some terms change, only the nodes on their paths are recomputed,
+ * bottom-up. Every node is created after its parent, so working through
+ * the changed nodes in decreasing node number always finishes the
+ * children before the parent.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "map.h"
+#include "search.h"
+#include "set.h"
+#include "vector.h"
+
+class Autocompleter {
+public:
+    /* The weight a term gains each time a replayed query uses it. */
+    static const long kQueryLogBoost = 10;
+
+    /* Keeps the best k (1 to 255) completions of each prefix. Calls error() for any other k. */
+    explicit Autocompleter(int k = 10);
+
+    /* Replaces the dictionary with the terms of index, each weighted by its number of pages. */
+    void build(const Map<std::string, Set<std::string>>& index);
+
+    /* Replaces the dictionary with terms, where docFreqs[i] is the number of pages with terms[i]. */
+    void build(const Vector<std::string>& terms, const Vector<long>& docFreqs);
+
+    /*
+     * Brings the listed terms up to date with index after it has changed:
+     * new terms are added, and terms no longer in index are never
+     * suggested again. Only the trie nodes on those terms' paths are
+     * recomputed.
+     */
+    void update(const Map<std::string, Set<std::string>>& index, const Set<std::string>& changedTerms);
+
+    /*
+     * Adds kQueryLogBoost to the weight of a dictionary term each time one
+     * of queries uses it. Queries are parsed with options, as they would be
+     * when run, so only terms that are in the index count. Misspelled words
+     * never become completions.
+     */
+    void replayQueryLog(const Vector<std::string>& queries, const IndexOptions& options);
+
+    /*
+     * Returns up to k dictionary terms starting with prefix. The heaviest
+     * come first, and terms of equal weight are in alphabetical order.
+     */
+    Vector<std::string> complete(const std::string& prefix) const;
+
+    /* Returns the weight of term, or 0 if it is not suggested. */
+    long weight(const std::string& term) const;
+
+    /* Returns the number of terms that can be suggested. */
+    int numTerms() const;
+
+private:
+    struct Node {
+        int firstChild = -1;      // children are linked in increasing order of ch
+        int nextSibling = -1;
+        int term = -1;            // the term ending here, or -1
+        int topStart = 0;         // _top[topStart, topStart + topCount) are the best terms below
+        unsigned char topCount = 0;
+        unsigned char topCapacity = 0;
+        char ch = 0;
+    };
+
+    int findNode(const std::string& prefix) const;
+    int addTerm(const std::string& term, std::vector<int>* path);
+    long termWeight(int term) const;
+    bool heavier(int a, int b) const;
+    void recompute(int node, bool exact);
+    void refresh(std::vector<int>& dirty);
+
+    int _k;
+    std::vector<Node> _nodes;         // _nodes[0] is the root, the empty prefix
+    std::vector<int> _top;            // every node's best terms, in one array
+    std::vector<std::string> _terms;
+    std::vector<long> _docFreq;
+    std::vector<long> _logWeight;
+    std::vector<int> _candidates;     // scratch space for recompute
+};
@@ -0,0 +1,482 @@
+/*
+ * File: docstore.cpp
+ * ------------------
+ * The block codec, the store writer and the reader. The compressor finds
+ * matches through a 4096-entry hash table of the last position of each
+ * 4-byte sequence, which is LZ4's fast mode in miniature.
+ */
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+#include "docstore.h"
+#include "error.h"
+#include "filecontents.h"
+#include "filelib.h"
+#include "map.h"
+#include "queryeval.h"
+#include "search.h"
+#include "set.h"
+#include "strlib.h"
+#include "tokenpipeline.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+static const char kStoreMagic[4] = {'D', 'O', 'C', 'S'};
+static const uint32_t kStoreVersion = 1;
+static const size_t kHeaderSize = 16;
+static const size_t kDocEntrySize = 20;
+static const size_t kBlockEntrySize = 16;
+
+static const int kMinMatch = 4;
+static const int kHashBits = 12;
+static const size_t kMaxOffset = 65535;
+
+static uint32_t readUint32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+}
+
+static uint64_t readUint64(const char* p) {
+    return readUint32(p) | uint64_t(readUint32(p + 4)) << 32;
+}
+
+static void appendUint32(string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out += char(value >> (8 * i));
+    }
+}
+
+static void appendUint64(string& out, uint64_t value) {
+    appendUint32(out, uint32_t(value));
+    appendUint32(out, uint32_t(value >> 32));
+}
+
+/* Appends a length field's extra bytes: 255s, then the remainder. */
+static void appendLength(string& out, size_t extra) {
+    for (; extra >= 255; extra -= 255) {
+        out += char(255);
+    }
+    out += char(extra);
+}
+
+static void appendSequence(string& out, const char* literals, size_t numLiterals, size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength - kMinMatch;
+    out += char((min(numLiterals, size_t(15)) << 4) | min(matchCode, size_t(15)));
+    if (numLiterals >= 15) appendLength(out, numLiterals - 15);
+    out.append(literals, numLiterals);
+    out += char(offset);
+    out += char(offset >> 8);
+    if (matchCode >= 15) appendLength(out, matchCode - 15);
+}
+
+void lzCompress(const char* data, size_t length, string& out) {
+    vector<int> table(1 << kHashBits, -1);
+    size_t anchor = 0;
+    // As in LZ4, matches stop short of the end so the last sequence is plain literals.
+    if (length > 12) {
+        size_t limit = length - 12;
+        size_t i = 0;
+        while (i < limit) {
+            uint32_t sequence;
+            memcpy(&sequence, data + i, 4);
+            uint32_t h = (sequence * 2654435761u) >> (32 - kHashBits);
+            int candidate = table[h];
+            table[h] = i;
+            if (candidate >= 0 && i - candidate <= kMaxOffset && memcmp(data + candidate, data + i, 4) == 0) {
+                size_t matchLength = kMinMatch;
+                size_t maxLength = length - 5 - i;
+                while (matchLength < maxLength && data[candidate + matchLength] == data[i + matchLength]) {
+                    matchLength++;
+                }
+                appendSequence(out, data + anchor, i - anchor, i - candidate, matchLength);
+                i += matchLength;
+                anchor = i;
+            } else {
+                i++;
+            }
+        }
+    }
+    size_t numLiterals = length - anchor;
+    out += char(min(numLiterals, size_t(15)) << 4);
+    if (numLiterals >= 15) appendLength(out, numLiterals - 15);
+    out.append(data + anchor, numLiterals);
+}
+
+/* Reads the extra bytes of a length field, checking they are all there. */
+static size_t readLength(const unsigned char* in, size_t length, size_t& pos) {
+    size_t extra = 0;
+    unsigned char byte;
+    do {
+        if (pos >= length) error("Doc store block is corrupt");
+        byte = in[pos++];
+        extra += byte;
+    } while (byte == 255);
+    return extra;
+}
+
+void lzDecompress(const char* data, size_t length, char* dest, size_t rawLength) {
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+    size_t pos = 0;
+    size_t outPos = 0;
+    while (pos < length) {
+        unsigned token = in[pos++];
+        size_t numLiterals = token >> 4;
+        if (numLiterals == 15) numLiterals += readLength(in, length, pos);
+        if (numLiterals > length - pos || numLiterals > rawLength - outPos) {
+            error("Doc store block is corrupt");
+        }
+        memcpy(dest + outPos, in + pos, numLiterals);
+        pos += numLiterals;
+        outPos += numLiterals;
+        if (pos == length) break;   // the last sequence has no match
+
+        if (length - pos < 2) error("Doc store block is corrupt");
+        size_t offset = in[pos] | in[pos + 1] << 8;
+        pos += 2;
+        size_t matchLength = (token & 15) + kMinMatch;
+        if ((token & 15) == 15) matchLength += readLength(in, length, pos);
+        if (offset == 0 || offset > outPos || matchLength > rawLength - outPos) {
+            error("Doc store block is corrupt");
+        }
+        if (offset >= matchLength) {
+            memcpy(dest + outPos, dest + outPos - offset, matchLength);
+            outPos += matchLength;
+        } else {
+            // Byte by byte, since the match overlaps the bytes it is producing.
+            for (size_t i = 0; i < matchLength; i++, outPos++) {
+                dest[outPos] = dest[outPos - offset];
+            }
+        }
+    }
+    if (outPos != rawLength) {
+        error("Doc store block is corrupt");
+    }
+}
+
+void writeDocStore(string filename, const Map<string, string>& pages, int blockSize) {
+    string docTable;
+    string blockTable;
+    string urls;
+    string blocks;
+    string raw;
+    int numBlocks = 0;
+    vector<uint64_t> blockOffsets;   // relative to the start of the blocks for now
+
+    auto closeBlock = [&]() {
+        if (raw.empty()) return;
+        size_t start = blocks.size();
+        lzCompress(raw.data(), raw.size(), blocks);
+        blockOffsets.push_back(start);
+        appendUint32(blockTable, blocks.size() - start);
+        appendUint32(blockTable, raw.size());
+        raw.clear();
+        numBlocks++;
+    };
+
+    for (const string& url : pages) {
+        const string& body = pages[url];
+        if (!raw.empty() && raw.size() + body.size() > size_t(blockSize)) {
+            closeBlock();
+        }
+        appendUint32(docTable, numBlocks);
+        appendUint32(docTable, raw.size());
+        appendUint32(docTable, body.size());
+        appendUint32(docTable, urls.size());
+        appendUint32(docTable, url.size());
+        raw += body;
+        urls += url;
+    }
+    closeBlock();
+
+    string header(kStoreMagic, sizeof(kStoreMagic));
+    appendUint32(header, kStoreVersion);
+    appendUint32(header, pages.size());
+    appendUint32(header, numBlocks);
+    uint64_t blocksStart = kHeaderSize + docTable.size() + size_t(numBlocks) * kBlockEntrySize + urls.size();
+
+    ofstream out(filename, ios::binary);
+    if (!out) {
+        error("Cannot write doc store " + filename);
+    }
+    out << header << docTable;
+    for (int i = 0; i < numBlocks; i++) {
+        string entry;
+        appendUint64(entry, blocksStart + blockOffsets[i]);
+        entry.append(blockTable, 8 * i, 8);
+        out << entry;
+    }
+    out << urls << blocks;
+    if (!out) {
+        error("Cannot write doc store " + filename);
+    }
+}
+
+DocStore::DocStore(string filename) : _cachedBlock(-1) {
+    if (!_file.open(filename)) {
+        error("Cannot open doc store " + filename);
+    }
+    const char* data = _file.data();
+    size_t size = _file.size();
+    if (size < kHeaderSize || memcmp(data, kStoreMagic, sizeof(kStoreMagic)) != 0) {
+        error(filename + " is not a doc store");
+    }
+    if (readUint32(data + 4) != kStoreVersion) {
+        error("Unsupported doc store version in " + filename);
+    }
+    _numDocs = readUint32(data + 8);
+    _numBlocks = readUint32(data + 12);
+    uint64_t tablesEnd = kHeaderSize + uint64_t(_numDocs) * kDocEntrySize + uint64_t(_numBlocks) * kBlockEntrySize;
+    if (_numDocs < 0 || _numBlocks < 0 || tablesEnd > size) {
+        error("Doc store " + filename + " is truncated");
+    }
+    _docTable = data + kHeaderSize;
+    _blockTable = _docTable + size_t(_numDocs) * kDocEntrySize;
+    _urls = _blockTable + size_t(_numBlocks) * kBlockEntrySize;
+}
+
+const char* DocStore::docEntry(int doc) const {
+    if (doc < 0 || doc >= _numDocs) {
+        error("DocStore: no document " + integerToString(doc));
+    }
+    return _docTable + size_t(doc) * kDocEntrySize;
+}
+
+string DocStore::url(int doc) const {
+    const char* entry = docEntry(doc);
+    size_t offset = readUint32(entry + 12);
+    size_t length = readUint32(entry + 16);
+    if (_urls + offset + length > _file.data() + _file.size()) {
+        error("Doc store is truncated");
+    }
+    return string(_urls + offset, length);
+}
+
+int DocStore::findUrl(const string& target) const {
+    int low = 0;
+    int high = _numDocs;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (url(mid) < target) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < _numDocs && url(low) == target ? low : -1;
+}
+
+const string& DocStore::block(int index) const {
+    if (index != _cachedBlock) {
+        if (index < 0 || index >= _numBlocks) {
+            error("Doc store is corrupt");
+        }
+        const char* entry = _blockTable + size_t(index) * kBlockEntrySize;
+        uint64_t offset = readUint64(entry);
+        size_t compressed = readUint32(entry + 8);
+        size_t rawLength = readUint32(entry + 12);
+        if (offset > _file.size() || compressed > _file.size() - offset) {
+            error("Doc store is truncated");
+        }
+        _cachedBlock = -1;   // in case decompression fails part way
+        _cache.resize(rawLength);
+        lzDecompress(_file.data() + offset, compressed, &_cache[0], rawLength);
+        _cachedBlock = index;
+    }
+    return _cache;
+}
+
+string DocStore::body(int doc) const {
+    const char* entry = docEntry(doc);
+    size_t offset = readUint32(entry + 4);
+    size_t length = readUint32(entry + 8);
+    if (length == 0) return "";   // may point just past the last block
+    const string& raw = block(readUint32(entry));
+    if (offset > raw.size() || length > raw.size() - offset) {
+        error("Doc store is corrupt");
+    }
+    return raw.substr(offset, length);
+}
+
+string DocStore::snippet(int doc, string query, const IndexOptions& options, int maxWords) const {
+    // The analyzed words of every term to highlight
+    Set<string> highlight;
+    for (const QueryTerm& term : parseQuery(query, options)) {
+        if (term.modifier == '-') continue;
+        for (const string& key : term.keys) {
+            for (const string& word : stringSplit(key, " ")) {
+                highlight.add(word);
+            }
+        }
+    }
+
+    // Find the words of the body, and which ones match
+    string text = body(doc);
+    TokenPipeline pipeline(options.removeStopWords, options.stem);
+    vector<size_t> starts, lengths;
+    vector<int> hits;   // hits[i] is the number of matching words before word i
+    hits.push_back(0);
+    for (size_t i = 0; i < text.size(); ) {
+        size_t end = text.find(' ', i);
+        if (end == string::npos) end = text.size();
+        if (end > i) {
+            TokenView term;
+            bool match = pipeline.analyzeWord(text.data() + i, end - i, term) && highlight.contains(term.toString());
+            starts.push_back(i);
+            lengths.push_back(end - i);
+            hits.push_back(hits.back() + match);
+        }
+        i = end + 1;
+    }
+
+    // Slide a window of maxWords words to the first place holding the most matches
+    int numWords = starts.size();
+    int window = min(maxWords, numWords);
+    int best = 0;
+    for (int first = 1; first + window <= numWords; first++) {
+        if (hits[first + window] - hits[first] > hits[best + window] - hits[best]) best = first;
+    }
+
+    string result = best > 0 ? "..." : "";
+    for (int i = best; i < best + window; i++) {
+        if (!result.empty()) result += ' ';
+        bool match = hits[i + 1] > hits[i];
+        if (match) result += '[';
+        result.append(text, starts[i], lengths[i]);
+        if (match) result += ']';
+    }
+    if (best + window < numWords) result += " ...";
+    return result;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+static string roundTrip(const string& data) {
+    string packed;
+    lzCompress(data.data(), data.size(), packed);
+    string unpacked(data.size(), '\0');
+    lzDecompress(packed.data(), packed.size(), &unpacked[0], unpacked.size());
+    return unpacked;
+}
+
+STUDENT_TEST("lzCompress and lzDecompress round-trip text, runs and random bytes") {
+    EXPECT_EQUAL(roundTrip(""), "");
+    EXPECT_EQUAL(roundTrip("a"), "a");
+    EXPECT_EQUAL(roundTrip("abcdabcdabcdabcdabcdabcd"), "abcdabcdabcdabcdabcdabcd");
+    string run(100000, 'x');
+    EXPECT_EQUAL(roundTrip(run), run);
+    string packed;
+    lzCompress(run.data(), run.size(), packed);
+    EXPECT(packed.size() < 500);
+
+    string noise;
+    mt19937 bytes(106);
+    for (int i = 0; i < 50000; i++) noise += char(bytes());
+    EXPECT_EQUAL(roundTrip(noise), noise);
+    string text;
+    for (int i = 0; i < 2000; i++) text += "the quick brown fox " + integerToString(i % 37) + " jumps\n";
+    EXPECT_EQUAL(roundTrip(text), text);
+
+    // Corrupt input is reported, never read or written out of bounds.
+    packed.clear();
+    lzCompress(text.data(), text.size(), packed);
+    string out(text.size(), '\0');
+    EXPECT_ERROR(lzDecompress(packed.data(), packed.size() / 2, &out[0], out.size()));
+    EXPECT_ERROR(lzDecompress(packed.data(), packed.size(), &out[0], out.size() - 1));
+    packed[1] = char(200);
+    EXPECT_ERROR(lzDecompress(packed.data(), 2, &out[0], out.size()));
+}
+
+STUDENT_TEST("buildIndex writes a doc store with every page's url and body") {
+    IndexOptions options;
+    options.docStoreFile = "res/_website.docs";
+    options.removeNearDuplicates = true;
+    Map<string, Set<string>> index;
+    int numPages = buildIndex("res/website.txt", index, options);
+    DocStore store(options.docStoreFile);
+    EXPECT_EQUAL(store.numDocs(), numPages);
+
+    ifstream file("res/website.txt");
+    string url, body;
+    int checked = 0;
+    while (getline(file, url) && getline(file, body)) {
+        int doc = store.findUrl(url);
+        EXPECT(doc >= 0);
+        EXPECT_EQUAL(store.url(doc), url);
+        EXPECT_EQUAL(store.body(doc), body);
+        checked++;
+    }
+    EXPECT_EQUAL(checked, numPages);
+    EXPECT_EQUAL(store.findUrl("https://example.com/not-a-page"), -1);
+
+    // Index doc numbers are not store doc numbers; results are found by url
+    CompiledIndex compiled(index);
+    for (int doc = 0; doc < compiled.numDocs(); doc++) {
+        EXPECT_EQUAL(store.url(store.findUrl(compiled.url(doc))), compiled.url(doc));
+    }
+    EXPECT_ERROR(store.body(numPages));
+
+    EXPECT(fileSize(options.docStoreFile) < fileSize("res/website.txt"));
+    deleteFile(options.docStoreFile);
+    EXPECT_ERROR(DocStore("res/_website.docs"));
+    EXPECT_ERROR(DocStore("res/tiny.txt"));
+}
+
+STUDENT_TEST("DocStore snippets highlight query terms in the best window") {
+    Map<string, string> pages;
+    pages["a"] = "one two three four five six seven Red eight nine fish ten eleven";
+    pages["b"] = "I eat FISH";
+    pages["c"] = "We graded the grading of graders";
+    writeDocStore("res/_tiny.docs", pages, 16);
+    DocStore store("res/_tiny.docs");
+    EXPECT_EQUAL(store.snippet(store.findUrl("a"), "red fish", IndexOptions(), 5), "... seven [Red] eight nine [fish] ...");
+    EXPECT_EQUAL(store.snippet(store.findUrl("a"), "red -fish", IndexOptions(), 3), "... six seven [Red] ...");
+    EXPECT_EQUAL(store.snippet(store.findUrl("b"), "fish"), "I eat [FISH]");
+    EXPECT_EQUAL(store.snippet(store.findUrl("b"), "hippo", IndexOptions(), 2), "I eat ...");
+
+    IndexOptions stemmed;
+    stemmed.stem = true;
+    EXPECT_EQUAL(store.snippet(store.findUrl("c"), "grade", stemmed), "We [graded] the [grading] of graders");
+    deleteFile("res/_tiny.docs");
+}
+
+static string bodyFromStore(const string& storeFile, const string& url) {
+    DocStore store(storeFile);
+    return store.body(store.findUrl(url));
+}
+
+static string bodyFromDatabase(const string& dbfile, const string& target) {
+    ifstream file(dbfile);
+    string url, body;
+    while (getline(file, url) && getline(file, body)) {
+        if (url == target) return body;
+    }
+    return "";
+}
+
+STUDENT_TEST("Fetching one page from the store vs re-scanning the database") {
+    IndexOptions options;
+    options.docStoreFile = "res/_website.docs";
+    Map<string, Set<string>> index;
+    buildIndex("res/website.txt", index, options);
+
+    // The last page in the database is the worst case for a scan.
+    ifstream file("res/website.txt");
+    string line, target;
+    for (int i = 0; getline(file, line); i++) {
+        if (i % 2 == 0) target = line;
+    }
+    string fromStore, fromScan, snippet;
+    TIME_OPERATION(1, fromStore = bodyFromStore(options.docStoreFile, target));
+    TIME_OPERATION(1, fromScan = bodyFromDatabase("res/website.txt", target));
+    EXPECT_EQUAL(fromStore, fromScan);
+
+    DocStore store(options.docStoreFile);
+    TIME_OPERATION(1, snippet = store.snippet(store.findUrl(target), "the"));
+    EXPECT(stringContains(snippet, "["));
+    deleteFile(options.docStoreFile);
+}
@@ -0,0 +1,109 @@
+/*
+ * File: docstore.h
+ * ----------------
+ * Defines a document store: a single file holding every page's url and
+ * body, so results can show text without re-reading the database. Bodies
+ * are packed into blocks of about 16KB, each compressed on its own, and
+ * fixed-width tables give the block and position of every document, so
+ * fetching one body decompresses only its block. The tables are read in
+ * place from the memory-mapped file; opening a store parses only the
+ * header.
+ *
+ * Store file layout (all integers little-endian):
+ *     bytes 0-3     magic "DOCS"
+ *     bytes 4-7     format version (1)
+ *     bytes 8-11    number of documents D
+ *     bytes 12-15   number of blocks B
+ *     then D doc entries of 5 x uint32:
+ *                   block, body offset within the block, body length,
+ *                   url offset within the url area, url length
+ *     then B block entries: uint64 file offset, uint32 compressed size,
+ *                   uint32 uncompressed size
+ *     then the url area, every url back to back, in sorted order
+ *     then the compressed blocks
+ * Documents are numbered in sorted url order over every page written to
+ * the store. These numbers are not CompiledIndex doc numbers: the index
+ * only numbers urls that have at least one term, and removing near
+ * duplicates drops pages from the index but not from the store. To show
+ * a query result, look its url up with findUrl.
+ *
+ * Blocks use a small built-in LZ77 codec with the LZ4 block layout:
+ * sequences of a token byte (4 bits literal length, 4 bits match length
+ * minus 4), extra length bytes when a field is 15, the literals, and a
+ * 2-byte match offset; the last sequence has literals only.
+ */
+
+#pragma once
+
+#include <string>
+#include "map.h"
+#include "filecontents.h"
+#include "search.h"
+
+// The uncompressed size at which a block is closed.
+const int kDocStoreBlockSize = 16384;
+
+/*
+ * The writeDocStore function writes a store holding pages, a map from url
+ * to body text. Calls error() if the file cannot be written.
+ */
+void writeDocStore(std::string filename, const Map<std::string, std::string>& pages,
+                   int blockSize = kDocStoreBlockSize);
+
+/*
+ * The lzCompress function appends the compressed form of data[0..length)
+ * to out; lzDecompress expands it again into exactly rawLength bytes at
+ * dest, calling error() if the input is corrupt.
+ */
+void lzCompress(const char* data, size_t length, std::string& out);
+void lzDecompress(const char* data, size_t length, char* dest, size_t rawLength);
+
+/*
+ * A DocStore reads a store file written by writeDocStore (or by
+ * buildIndex when IndexOptions::docStoreFile is set). The most recently
+ * used block is kept decompressed, so pulling several documents from one
+ * block decompresses it once.
+ */
+class DocStore {
+public:
+    /* Opens the store, calling error() if it is missing or malformed. */
+    DocStore(std::string filename);
+
+    int numDocs() const {
+        return _numDocs;
+    }
+
+    std::string url(int doc) const;
+    std::string body(int doc) const;
+
+    /*
+     * Returns the number of the document with this url, or -1. This is a
+     * binary search over the sorted url area, so it reads about log2(D)
+     * urls.
+     */
+    int findUrl(const std::string& url) const;
+
+    /*
+     * Returns up to maxWords consecutive words of the document's body,
+     * chosen to hold as many of the query's terms as possible, with each
+     * matching word in [brackets] and "..." where text was cut. Words are
+     * matched by analyzing them with options, so with stemming "graded"
+     * is highlighted for the query "grading". Terms with a '-' modifier
+     * are not highlighted.
+     */
+    std::string snippet(int doc, std::string query, const IndexOptions& options = IndexOptions(),
+                        int maxWords = 24) const;
+
+private:
+    const char* docEntry(int doc) const;
+    const std::string& block(int index) const;
+
+    FileContents _file;
+    int _numDocs;
+    int _numBlocks;
+    const char* _docTable;
+    const char* _blockTable;
+    const char* _urls;
+    mutable int _cachedBlock;
+    mutable std::string _cache;
+};
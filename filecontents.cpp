@@ -0,0 +1,53 @@
+/*
+ * File: filecontents.cpp
+ * ----------------------
+ * Memory-maps the file where mmap is available and falls back to reading
+ * it into a buffer in one call.
+ */
+#include <fstream>
+#include <sstream>
+#include <string>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "filecontents.h"
+using namespace std;
+
+
+FileContents::~FileContents() {
+#ifndef _WIN32
+    if (_mapped) munmap(const_cast<char*>(_data), _size);
+#endif
+}
+
+bool FileContents::open(const string& filename) {
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* addr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            madvise(addr, info.st_size, MADV_SEQUENTIAL);
+            ::close(fd);
+            _data = static_cast<const char*>(addr);
+            _size = info.st_size;
+            _mapped = true;
+            return true;
+        }
+    }
+    ::close(fd);
+#endif
+    // No mmap (or an empty/special file): read the whole file in one call
+    ifstream in(filename, ios::binary);
+    if (!in) return false;
+    ostringstream contents;
+    contents << in.rdbuf();
+    _buffer = contents.str();
+    _data = _buffer.data();
+    _size = _buffer.size();
+    return true;
+}
@@ -0,0 +1,36 @@
+/*
+ * File: filecontents.h
+ * --------------------
+ * Defines FileContents, whole-file read-only access shared by the maze
+ * loaders and the document store.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*
+ * The FileContents class gives read-only access to the whole contents of a
+ * file. Where the platform supports it the file is memory-mapped, so no copy
+ * is made; otherwise it is read into a buffer in one go.
+ */
+class FileContents {
+public:
+    FileContents() = default;
+    ~FileContents();
+    FileContents(const FileContents&) = delete;
+    FileContents& operator=(const FileContents&) = delete;
+
+    /* Opens the named file, returning false if it cannot be opened or read. */
+    bool open(const std::string& filename);
+
+    const char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+    bool _mapped = false;
+    std::string _buffer;
+};
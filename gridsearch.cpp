@@ -0,0 +1,334 @@
+/*
+ * File: gridsearch.cpp
+ * --------------------
+ * The policy-templated breadth- and depth-first searches, and their
+ * explicit instantiations. Each location keeps one byte: zero while
+ * unreached, otherwise one plus the direction back to the location it was
+ * reached from (kNumDirs + 1 for the entry). Location numbers are
+ * row * numCols + col, held in an int, so larger mazes are refused.
+ */
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <vector>
+#include "error.h"
+#include "grid.h"
+#include "gridsearch.h"
+#include "maze.h"
+#include "mazegenerator.h"
+#include "mazeprogress.h"
+#include "mazestats.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+ByteCells::ByteCells(const Grid<bool>& grid) : _numRows(grid.numRows()), _numCols(grid.numCols()) {
+    _cells.reserve(long(_numRows) * _numCols);
+    for (bool open : grid) {
+        _cells.push_back(open);
+    }
+}
+
+BitCells::BitCells(const Grid<bool>& grid) : _numRows(grid.numRows()), _numCols(grid.numCols()) {
+    _words.assign((long(_numRows) * _numCols + 63) / 64, 0);
+    long index = 0;
+    for (bool open : grid) {
+        if (open) _words[index >> 6] |= uint64_t(1) << (index & 63);
+        index++;
+    }
+}
+
+/* Fills soln with the path from the entry to cell, following the back directions in from. */
+template <typename Connectivity>
+static void tracePath(const vector<unsigned char>& from, int cell, int numCols, Vector<GridLocation>& soln) {
+    const unsigned char kStart = Connectivity::kNumDirs + 1;
+    vector<GridLocation> path = {{cell / numCols, cell % numCols}};
+    while (from[cell] != kStart) {
+        int back = from[cell] - 1;
+        cell += Connectivity::rowStep(back) * numCols + Connectivity::colStep(back);
+        path.push_back({cell / numCols, cell % numCols});
+    }
+    soln.clear();
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        soln.add(*it);
+    }
+}
+
+/*
+ * The visitor for forEachDirection that reaches each unreached open
+ * neighbor of (row, col), records the way back, reports it to progress
+ * and passes its location number to reach.
+ */
+template <typename Connectivity, typename Cells, typename Reach>
+struct NeighborVisitor {
+    const Cells& cells;
+    vector<unsigned char>& from;
+    MazeProgress* progress;
+    Reach& reach;
+    int numRows, numCols, row, col;
+
+    void operator()(int dir) {
+        int r = row + Connectivity::rowStep(dir);
+        int c = col + Connectivity::colStep(dir);
+        if (r < 0 || r >= numRows || c < 0 || c >= numCols || !cells.isOpen(r, c)) return;
+        int next = r * numCols + c;
+        if (from[next] == 0) {
+            from[next] = Connectivity::kNumDirs - dir;   // 1 + the opposite direction
+            if (progress) progress->report(MAZE_FRONTIER, {r, c});
+            reach(next);
+        }
+    }
+};
+
+/* Fills in stats at the end of a search. */
+static void recordSearch(SolveStats* stats, long expanded, long peakFrontier, long peakBytes,
+                         double solveMs, double reconstructMs, int pathLength) {
+    stats->nodesExpanded = expanded;
+    stats->peakFrontier = peakFrontier;
+    stats->peakBytes = peakBytes;
+    stats->solveMs = solveMs;
+    stats->reconstructMs = reconstructMs;
+    stats->pathLength = pathLength;
+}
+
+template <typename Connectivity, typename Cells>
+bool searchBreadthFirst(const Cells& cells, Vector<GridLocation>& soln, MazeProgress* progress, SolveStats* stats) {
+    int numRows = cells.numRows();
+    int numCols = cells.numCols();
+    long numCells = long(numRows) * numCols;
+    if (numCells > INT_MAX) {
+        error("searchBreadthFirst: maze has too many locations");
+    }
+    bool tracking = statsEnabled(stats);
+    if (numCells == 0) {
+        if (tracking) recordSearch(stats, 0, 0, 0, 0, 0, 0);
+        return false;
+    }
+    PhaseTimer timer(tracking);
+    long peakFrontier = 0;
+
+    // Every location is queued at most once, so the queue is a vector read from the front.
+    vector<unsigned char> from(numCells, 0);
+    vector<int> queue = {0};
+    from[0] = Connectivity::kNumDirs + 1;
+    if (progress) progress->report(MAZE_FRONTIER, {0, 0});
+    auto reach = [&](int next) { queue.push_back(next); };
+
+    size_t head = 0;
+    for (; head < queue.size(); head++) {
+        if (tracking) peakFrontier = max(peakFrontier, long(queue.size() - head));
+        int cell = queue[head];
+        int row = cell / numCols;
+        int col = cell - row * numCols;
+        if (progress) progress->report(MAZE_VISITED, {row, col});
+        if (cell == numCells - 1) {
+            double solveMs = timer.lapMs();
+            tracePath<Connectivity>(from, cell, numCols, soln);
+            if (tracking) {
+                long bytes = numCells + queue.capacity() * sizeof(int) + 2 * soln.size() * sizeof(GridLocation);
+                recordSearch(stats, head + 1, peakFrontier, bytes, solveMs, timer.lapMs(), soln.size());
+            }
+            return true;
+        }
+        NeighborVisitor<Connectivity, Cells, decltype(reach)> visit = {cells, from, progress, reach, numRows, numCols, row, col};
+        forEachDirection<Connectivity>(visit);
+    }
+    if (tracking) {
+        recordSearch(stats, head, peakFrontier, numCells + queue.capacity() * sizeof(int), timer.lapMs(), 0, 0);
+    }
+    return false;
+}
+
+template <typename Connectivity, typename Cells>
+bool searchDepthFirst(const Cells& cells, Vector<GridLocation>& soln, MazeProgress* progress, SolveStats* stats) {
+    int numRows = cells.numRows();
+    int numCols = cells.numCols();
+    long numCells = long(numRows) * numCols;
+    if (numCells > INT_MAX) {
+        error("searchDepthFirst: maze has too many locations");
+    }
+    bool tracking = statsEnabled(stats);
+    if (numCells == 0) {
+        if (tracking) recordSearch(stats, 0, 0, 0, 0, 0, 0);
+        return false;
+    }
+    PhaseTimer timer(tracking);
+    long expanded = 0;
+    long peakFrontier = 0;
+
+    // Locations are marked when pushed, so the stack never holds one twice.
+    vector<unsigned char> from(numCells, 0);
+    vector<int> stack;
+    stack.reserve(numCells);
+    stack.push_back(0);
+    from[0] = Connectivity::kNumDirs + 1;
+    if (progress) progress->report(MAZE_FRONTIER, {0, 0});
+    auto reach = [&](int next) { stack.push_back(next); };
+
+    while (!stack.empty()) {
+        if (tracking) peakFrontier = max(peakFrontier, long(stack.size()));
+        int cell = stack.back();
+        stack.pop_back();
+        expanded++;
+        int row = cell / numCols;
+        int col = cell - row * numCols;
+        if (progress) progress->report(MAZE_VISITED, {row, col});
+        if (cell == numCells - 1) {
+            double solveMs = timer.lapMs();
+            tracePath<Connectivity>(from, cell, numCols, soln);
+            if (tracking) {
+                long bytes = numCells + stack.capacity() * sizeof(int) + 2 * soln.size() * sizeof(GridLocation);
+                recordSearch(stats, expanded, peakFrontier, bytes, solveMs, timer.lapMs(), soln.size());
+            }
+            return true;
+        }
+        NeighborVisitor<Connectivity, Cells, decltype(reach)> visit = {cells, from, progress, reach, numRows, numCols, row, col};
+        forEachDirection<Connectivity>(visit);
+    }
+    if (tracking) {
+        recordSearch(stats, expanded, peakFrontier, numCells + stack.capacity() * sizeof(int), timer.lapMs(), 0, 0);
+    }
+    return false;
+}
+
+#define INSTANTIATE_GRID_SEARCHES(Connectivity, Cells)                                              \
+    template bool searchBreadthFirst<Connectivity, Cells>(const Cells&, Vector<GridLocation>&, MazeProgress*, SolveStats*); \
+    template bool searchDepthFirst<Connectivity, Cells>(const Cells&, Vector<GridLocation>&, MazeProgress*, SolveStats*);
+
+INSTANTIATE_GRID_SEARCHES(FourConnected, GridCells)
+INSTANTIATE_GRID_SEARCHES(FourConnected, ByteCells)
+INSTANTIATE_GRID_SEARCHES(FourConnected, BitCells)
+INSTANTIATE_GRID_SEARCHES(EightConnected, GridCells)
+INSTANTIATE_GRID_SEARCHES(EightConnected, ByteCells)
+INSTANTIATE_GRID_SEARCHES(EightConnected, BitCells)
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Checks that path goes from entry to exit through open locations one king's move at a time. */
+static bool isEightConnectedPath(const Grid<bool>& maze, const Vector<GridLocation>& path) {
+    if (path.isEmpty() || path[0] != GridLocation(0, 0)) return false;
+    if (path[path.size() - 1] != GridLocation(maze.numRows() - 1, maze.numCols() - 1)) return false;
+    for (int i = 0; i < path.size(); i++) {
+        if (!maze.inBounds(path[i].row, path[i].col) || !maze[path[i].row][path[i].col]) return false;
+        if (i > 0 && (abs(path[i].row - path[i - 1].row) > 1 || abs(path[i].col - path[i - 1].col) > 1
+                      || path[i] == path[i - 1])) return false;
+    }
+    return true;
+}
+
+STUDENT_TEST("Every cell storage gives the same paths as solveMazeBFS and solveMazeDFS") {
+    for (string name : {"res/5x7.maze", "res/21x35.maze", "res/33x41.maze", "res/6x6.maze", "res/24x32.maze"}) {
+        Grid<bool> maze;
+        readMazeFile(name, maze);
+        ByteCells bytes(maze);
+        BitCells bits(maze);
+        Vector<GridLocation> expected, soln;
+        bool solvable = solveMazeBFS(maze, expected);
+        EXPECT_EQUAL(searchBreadthFirst<FourConnected>(bytes, soln), solvable);
+        EXPECT_EQUAL(soln, expected);
+        EXPECT_EQUAL(searchBreadthFirst<FourConnected>(bits, soln), solvable);
+        EXPECT_EQUAL(soln, expected);
+
+        solvable = solveMazeDFS(maze, expected);
+        EXPECT_EQUAL(searchDepthFirst<FourConnected>(bytes, soln), solvable);
+        EXPECT_EQUAL(soln, expected);
+        EXPECT_EQUAL(searchDepthFirst<FourConnected>(bits, soln), solvable);
+        EXPECT_EQUAL(soln, expected);
+    }
+}
+
+STUDENT_TEST("EightConnected searches may move diagonally") {
+    Grid<bool> diagonal = {{true, false, false},
+                           {false, true, false},
+                           {false, false, true}};
+    Vector<GridLocation> soln;
+    EXPECT(!searchBreadthFirst<FourConnected>(GridCells(diagonal), soln));
+    EXPECT(searchBreadthFirst<EightConnected>(GridCells(diagonal), soln));
+    EXPECT_EQUAL(soln, {{0, 0}, {1, 1}, {2, 2}});
+    EXPECT(searchDepthFirst<EightConnected>(BitCells(diagonal), soln));
+    EXPECT_EQUAL(soln, {{0, 0}, {1, 1}, {2, 2}});
+
+    // Diagonals can only shorten a shortest path
+    for (MazeStyle style : {MAZE_BACKTRACKER, MAZE_ROOMS}) {
+        Grid<bool> maze;
+        generateMaze(maze, 41, 61, style, 5);
+        Vector<GridLocation> four, eight, eightBits, eightDepth;
+        EXPECT(searchBreadthFirst<FourConnected>(GridCells(maze), four));
+        EXPECT(searchBreadthFirst<EightConnected>(GridCells(maze), eight));
+        EXPECT(searchBreadthFirst<EightConnected>(BitCells(maze), eightBits));
+        EXPECT(searchDepthFirst<EightConnected>(ByteCells(maze), eightDepth));
+        EXPECT(eight.size() <= four.size());
+        EXPECT_EQUAL(eightBits, eight);
+        EXPECT(isEightConnectedPath(maze, eight));
+        EXPECT(isEightConnectedPath(maze, eightDepth));
+    }
+}
+
+/* An open field that only claims its size, so the limit can be tested without allocating it. */
+struct OpenFieldCells {
+    int rows, cols;
+    int numRows() const { return rows; }
+    int numCols() const { return cols; }
+    bool isOpen(int, int) const { return true; }
+};
+
+STUDENT_TEST("Searches refuse mazes with more locations than an int can number") {
+    Vector<GridLocation> soln;
+    OpenFieldCells huge = {65536, 32769};
+    EXPECT_ERROR(searchBreadthFirst<FourConnected>(huge, soln));
+    EXPECT_ERROR(searchDepthFirst<EightConnected>(huge, soln));
+
+    OpenFieldCells small = {3, 4};
+    EXPECT(searchBreadthFirst<FourConnected>(small, soln));
+    EXPECT_EQUAL(soln.size(), 6);
+}
+
+/* The parent-array BFS written out by hand for Grid<bool>, as the baseline for the templates. */
+static bool handWrittenBFS(const Grid<bool>& maze, Vector<GridLocation>& soln) {
+    static const int rowSteps[4] = {-1, 0, 0, 1};
+    static const int colSteps[4] = {0, -1, 1, 0};
+    int numRows = maze.numRows();
+    int numCols = maze.numCols();
+    long numCells = long(numRows) * numCols;
+    vector<unsigned char> from(numCells, 0);
+    vector<int> queue = {0};
+    from[0] = 5;
+    for (size_t head = 0; head < queue.size(); head++) {
+        int cell = queue[head];
+        int row = cell / numCols;
+        int col = cell - row * numCols;
+        if (cell == numCells - 1) {
+            tracePath<FourConnected>(from, cell, numCols, soln);
+            return true;
+        }
+        for (int dir = 0; dir < 4; dir++) {
+            int r = row + rowSteps[dir];
+            int c = col + colSteps[dir];
+            if (r < 0 || r >= numRows || c < 0 || c >= numCols || !maze[r][c]) continue;
+            int next = r * numCols + c;
+            if (from[next] == 0) {
+                from[next] = 4 - dir;
+                queue.push_back(next);
+            }
+        }
+    }
+    return false;
+}
+
+STUDENT_TEST("Templated search time vs a hand-written loop, by cell storage") {
+    Grid<bool> maze;
+    generateMaze(maze, 2001, 2001, MAZE_BACKTRACKER);
+    int n = maze.numRows() * maze.numCols();
+    ByteCells bytes(maze);
+    BitCells bits(maze);
+    Vector<GridLocation> expected, soln;
+    TIME_OPERATION(n, handWrittenBFS(maze, expected));
+    TIME_OPERATION(n, searchBreadthFirst<FourConnected>(GridCells(maze), soln));
+    EXPECT_EQUAL(soln, expected);
+    TIME_OPERATION(n, searchBreadthFirst<FourConnected>(bytes, soln));
+    TIME_OPERATION(n, searchBreadthFirst<FourConnected>(bits, soln));
+    EXPECT_EQUAL(soln, expected);
+    TIME_OPERATION(n, searchBreadthFirst<EightConnected>(bytes, soln));
+}
@@ -0,0 +1,141 @@
+/*
+ * File: gridsearch.h
+ * ------------------
+ * Defines the search core behind solveMazeBFS and solveMazeDFS, as
+ * templates on two policies, so that each combination compiles to its own
+ * tight loop with nothing decided at run time:
+ *
+ *   Connectivity  which neighbors a location has. FourConnected is
+ *                 north/west/east/south, the moves of generateValidMoves.
+ *                 EightConnected adds the diagonals. Each gives
+ *                 kNumDirs and constexpr row and column steps in sorted
+ *                 (row, then column) order, so direction kNumDirs-1-d is
+ *                 the opposite of d. The neighbor loop is unrolled by
+ *                 forEachDirection, so every step is a constant.
+ *
+ *   Cells         how open locations are stored. GridCells reads a
+ *                 Grid<bool> in place, ByteCells one byte per location
+ *                 and BitCells one bit per location, row-major.
+ *
+ * Both searches find the same path the original Set/Vector-based solvers
+ * did: neighbors are taken in direction order and marked when first
+ * reached, and the path is recovered from one back-direction byte per
+ * location.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "grid.h"
+#include "vector.h"
+
+class MazeProgress;
+struct SolveStats;
+
+// The steps of each connectivity, in sorted (row, then column) order.
+static constexpr int kFourRowSteps[4] = {-1, 0, 0, 1};
+static constexpr int kFourColSteps[4] = {0, -1, 1, 0};
+static constexpr int kEightRowSteps[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+static constexpr int kEightColSteps[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+
+struct FourConnected {
+    static const int kNumDirs = 4;
+    static constexpr int rowStep(int dir) { return kFourRowSteps[dir]; }
+    static constexpr int colStep(int dir) { return kFourColSteps[dir]; }
+};
+
+struct EightConnected {
+    static const int kNumDirs = 8;
+    static constexpr int rowStep(int dir) { return kEightRowSteps[dir]; }
+    static constexpr int colStep(int dir) { return kEightColSteps[dir]; }
+};
+
+/*
+ * Calls visit(0), visit(1), ..., visit(N - 1) as N separate calls, so
+ * once visit is inlined each call sees its direction as a constant.
+ */
+template <int N>
+struct Unrolled {
+    template <typename Visit>
+    static void forEach(Visit& visit) {
+        Unrolled<N - 1>::forEach(visit);
+        visit(N - 1);
+    }
+};
+
+template <>
+struct Unrolled<0> {
+    template <typename Visit>
+    static void forEach(Visit&) {}
+};
+
+template <typename Connectivity, typename Visit>
+inline void forEachDirection(Visit& visit) {
+    Unrolled<Connectivity::kNumDirs>::forEach(visit);
+}
+
+/* Reads a Grid<bool> in place. */
+class GridCells {
+public:
+    GridCells(const Grid<bool>& grid) : _grid(grid) {}
+    int numRows() const { return _grid.numRows(); }
+    int numCols() const { return _grid.numCols(); }
+    bool isOpen(int row, int col) const { return _grid[row][col]; }
+
+private:
+    const Grid<bool>& _grid;
+};
+
+/* One byte per location, nonzero for open. */
+class ByteCells {
+public:
+    ByteCells(const Grid<bool>& grid);
+    int numRows() const { return _numRows; }
+    int numCols() const { return _numCols; }
+    bool isOpen(int row, int col) const { return _cells[long(row) * _numCols + col]; }
+
+private:
+    int _numRows, _numCols;
+    std::vector<unsigned char> _cells;
+};
+
+/* One bit per location, set for open; an eighth of the memory of ByteCells. */
+class BitCells {
+public:
+    BitCells(const Grid<bool>& grid);
+    int numRows() const { return _numRows; }
+    int numCols() const { return _numCols; }
+    bool isOpen(int row, int col) const {
+        long index = long(row) * _numCols + col;
+        return _words[index >> 6] >> (index & 63) & 1;
+    }
+
+private:
+    int _numRows, _numCols;
+    std::vector<uint64_t> _words;
+};
+
+/*
+ * The searchBreadthFirst function finds a shortest path from the upper
+ * left to the lower right of cells, stores it in soln and returns true, or
+ * returns false if there is none. progress, if not null, receives the same
+ * events solveMazeBFS reports, and stats, if not null, is filled in (see
+ * mazestats.h); peakBytes counts the back-direction bytes, the queue and
+ * the path as it is recovered. Calls error() if cells has more than
+ * INT_MAX locations.
+ */
+template <typename Connectivity, typename Cells>
+bool searchBreadthFirst(const Cells& cells, Vector<GridLocation>& soln, MazeProgress* progress = nullptr,
+                        SolveStats* stats = nullptr);
+
+/*
+ * The searchDepthFirst function finds a path by depth-first search in the
+ * way solveMazeDFS does, not necessarily the shortest.
+ */
+template <typename Connectivity, typename Cells>
+bool searchDepthFirst(const Cells& cells, Vector<GridLocation>& soln, MazeProgress* progress = nullptr,
+                      SolveStats* stats = nullptr);
+
+// Both searches are instantiated in gridsearch.cpp for every pairing of
+// FourConnected or EightConnected with GridCells, ByteCells or BitCells.
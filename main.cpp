@@ -2,6 +2,7 @@
 #include "console.h"
 #include "SimpleTest.h"
 #include "maze.h"
+#include "mazebatch.h"
 #include "search.h"
 using namespace std;
 
@@ -14,10 +15,7 @@ int main() {
         return 0;
     }
 
-    Grid<bool> maze;
-    Vector<GridLocation> soln;
-    readMazeFile("res/21x23.maze", maze);
-    solveMazeBFS(maze, soln);
+    solveMazeBatch({"res"});
 
     searchEngine("res/website.txt");
 
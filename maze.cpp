@@ -11,12 +11,20 @@
  */
 #include <iostream>
 #include <fstream>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "arraycollections.h"
 #include "error.h"
+#include "filecontents.h"
 #include "filelib.h"
 #include "grid.h"
+#include "gridsearch.h"
 #include "maze.h"
+#include "mazegenerator.h"
 #include "mazegraphics.h"
-#include "queue.h"
+#include "mazeio.h"
+#include "mazeprogress.h"
 #include "set.h"
 #include "stack.h"
 #include "vector.h"
@@ -58,195 +66,163 @@ Set<GridLocation> generateValidMoves(Grid<bool>& maze, GridLocation cur) {
 }
 
 /*
- * The validatePath function takes in a maze and path and tells
- * whether or not the coordinated path can correctly solve the maze.
+ * The findPathError function does the work for validatePath and validatePaths.
+ * Each step is checked in constant time (one step N/S/E/W onto an open cell)
+ * and revisits are caught with a visited bitmap with one bit per maze location.
+ * Before returning, the bits set for this path are cleared again, so callers
+ * checking many paths can share one bitmap and each check costs time
+ * proportional to the path length only.
  * @param maze is the puzzle needing to be solved
- * @param is a vector that lists out coordinates that attempts to solve the maze
- * @return an error statement if the maze cannot be solved and why it can't be solved.
+ * @param path is the path to check
+ * @param visited has one bit per maze location in row-major order, all clear
+ * @return the reason the path is invalid, or the empty string if it is valid
  */
-void validatePath(Grid<bool>& maze, Vector<GridLocation>& path) {
+static string findPathError(const Grid<bool>& maze, const Vector<GridLocation>& path, vector<bool>& visited) {
     if (path.isEmpty())
     {
-        error("Path is empty!");
+        return "Path is empty!";
     }
 
     GridLocation start = {0, 0};
     GridLocation exit = {maze.numRows() - 1, maze.numCols() - 1};
-    Set<GridLocation> beenThere;
 
     if(path[0] != start)
     {
-        error("Path doesn't begin at the entry (upper left corner)");
+        return "Path doesn't begin at the entry (upper left corner)";
     }
     if(path[path.size() - 1] != exit)
     {
-        error("Path doesn't end at the exit (lower right corner)");
+        return "Path doesn't end at the exit (lower right corner)";
     }
-    for(int i = 0; i < path.size() - 1; i++)
+
+    long numCols = maze.numCols();
+    string problem;
+    int numMarked = 1;
+    visited[0] = true;
+    for(; numMarked < path.size(); numMarked++)
     {
-        if (!generateValidMoves(maze, path[i]).contains(path[i + 1]))
-        {
-            error("Path doesn't contain valid moves");
-        }
-        else if (beenThere.contains(path[i]))
+        const GridLocation& prev = path[numMarked - 1];
+        const GridLocation& cur = path[numMarked];
+        if (abs(cur.row - prev.row) + abs(cur.col - prev.col) != 1
+            || !maze.inBounds(cur.row, cur.col) || !maze[cur.row][cur.col])
         {
-            error("Path contains a looped sequence");
+            problem = "Path doesn't contain valid moves";
+            break;
         }
-        else
+        if (visited[cur.row * numCols + cur.col])
         {
-            beenThere.add(path[i]);
+            problem = "Path contains a looped sequence";
+            break;
         }
+        visited[cur.row * numCols + cur.col] = true;
     }
 
+    for (int i = 0; i < numMarked; i++)
+    {
+        visited[path[i].row * numCols + path[i].col] = false;
+    }
+    return problem;
+}
+
+/*
+ * The validatePath function takes in a maze and path and tells
+ * whether or not the coordinated path can correctly solve the maze.
+ * Runs in time linear in the path length, plus clearing one bit per maze location.
+ * @param maze is the puzzle needing to be solved
+ * @param is a vector that lists out coordinates that attempts to solve the maze
+ * @return an error statement if the maze cannot be solved and why it can't be solved.
+ */
+void validatePath(Grid<bool>& maze, Vector<GridLocation>& path) {
+    vector<bool> visited(long(maze.numRows()) * maze.numCols());
+    string problem = findPathError(maze, path, visited);
 
     /* If you find a problem with the path, call error() to report it.
      * If the path is a valid solution, then this function should run to completion
      * without raising any errors.
      */
+    if (!problem.empty())
+    {
+        error(problem);
+    }
+}
+
+/*
+ * The validatePaths function checks many candidate paths against one maze.
+ * The visited bitmap is allocated once and shared by all the paths, so each
+ * path costs time proportional to its own length only.
+ * @param maze is the puzzle needing to be solved
+ * @param paths are the candidate solutions
+ * @return for each path, the message validatePath would report, or "" if it is valid
+ */
+Vector<string> validatePaths(Grid<bool>& maze, const Vector<Vector<GridLocation>>& paths) {
+    vector<bool> visited(long(maze.numRows()) * maze.numCols());
+    Vector<string> problems;
+    for (const Vector<GridLocation>& path : paths)
+    {
+        problems.add(findPathError(maze, path, visited));
+    }
+    return problems;
 }
 
 /*
  * The solveMazeBFS function takes in a parameter maze and soln.
- * This function uses breadth first search to test the paths in the maze.
- * Using the generateValidMoves function, solveMazeBFS can generate several
- * paths and test whether or not the maze can be solved and reach the exit.
+ * This function uses breadth first search to test the paths in the maze,
+ * taking neighbors in generateValidMoves order and marking each location
+ * when it is first queued. The search itself is searchBreadthFirst from
+ * gridsearch.h, run four-connected on the grid in place; it keeps one
+ * back-direction byte per location instead of a whole path per queue entry.
  * If it can be solved it returns true and assigns the soln variable the solution
  * vector to the maze. Similar to solveMazeDFS, but instead of using stacks it uses queues.
  * @param maze is the maze that needs to be solved
  * @param soln is the variable used to hold the solutions to the maze if generated
+ * @param progress if not null, receives an event for each location queued and visited
+ * @param stats if not null, receives the expansions, peaks and timings of the solve
  * @return true if the maze can be solved and false if it is empty or can't be solved
  */
-bool solveMazeBFS(Grid<bool>& maze, Vector<GridLocation>& soln) {
-    Queue<Vector<GridLocation>> allPaths;
-    Set<GridLocation> visited;
-    allPaths.enqueue({{0, 0}});
-    visited.add({0, 0});
-    GridLocation currentLocation = {0, 0};
-
-    while(!allPaths.isEmpty())
-    {
-        //setting up a test for a new set path
-        Vector<GridLocation> currentPath = allPaths.peek();
-        allPaths.dequeue();
-
-        currentLocation = currentPath.get(currentPath.size() - 1);
-
-        //testing whether the current location is the exit of the maze
-        if(currentLocation.row == maze.numRows() - 1 && currentLocation.col == maze.numCols() - 1)
-        {
-            soln = currentPath;
-            return true;
-        }
-
-        Set<GridLocation> potentialMoves = generateValidMoves(maze, currentLocation);
-        for(auto nextMove : potentialMoves)
-        {
-            GridLocation nextLocation = {nextMove.row, nextMove.col};
-            if(!visited.contains({nextMove.row, nextMove.col}))
-            {
-                visited.add({nextMove.row, nextMove.col});
-                Vector<GridLocation> newPath = currentPath;
-                newPath.add(nextLocation);
-                allPaths.enqueue(newPath);
-            }
-        }
-    }
-
-    return false;
+bool solveMazeBFS(Grid<bool>& maze, Vector<GridLocation>& soln, MazeProgress* progress, SolveStats* stats) {
+    return searchBreadthFirst<FourConnected>(GridCells(maze), soln, progress, stats);
 }
 
 /*
  * The solveMazeDFS function takes in a parameter maze and soln.
  * This function uses depth first search to test the paths in the maze.
- * Using the generateValidMoves function, solveMazeDFS can generate several
- * paths and test whether or not the maze can be solved and reach the exit.
+ * It explores from the entry with an explicit stack of cell numbers
+ * (row * numCols + col), which never holds a cell twice and so needs no
+ * allocation past its initial reservation. Each cell keeps one byte: zero
+ * while unvisited, otherwise one plus the direction back to the cell it
+ * was reached from. The solution is read off those bytes by walking back
+ * from the exit. Cells are marked visited when pushed and neighbors are
+ * pushed in generateValidMoves order, so the path is the same one found by
+ * keeping a stack of whole paths. It is not necessarily the shortest.
+ * The search itself is searchDepthFirst from gridsearch.h.
  * If it can be solved it returns true and assigns the soln variable the solution
  * vector to the maze. Similar to solveMazeBFS, but instead of using queues it uses stacks.
  * @param maze is the maze that needs to be solved
  * @param soln is the variable used to hold the solutions to the maze if generated
+ * @param progress if not null, receives an event for each location stacked and visited
+ * @param stats if not null, receives the expansions, peaks and timings of the solve
  * @return true if the maze can be solved and false if it is empty or can't be solved
  */
-bool solveMazeDFS(Grid<bool>& maze, Vector<GridLocation>& soln) {
-    Stack<Vector<GridLocation>> allPaths;
-    Set<GridLocation> visited;
-    allPaths.push({{0, 0}});
-    visited.add({0, 0});
-    GridLocation currentLocation = {0, 0};
-
-    while(!allPaths.isEmpty())
-    {
-        //setting up a test for a new set path
-        Vector<GridLocation> currentPath = allPaths.peek();
-        allPaths.pop();
-
-        currentLocation = currentPath.get(currentPath.size() - 1);
-
-        //testing whether the current location is the exit of the maze
-        if(currentLocation.row == maze.numRows() - 1 && currentLocation.col == maze.numCols() - 1)
-        {
-            soln = currentPath;
-            return true;
-        }
-
-        Set<GridLocation> potentialMoves = generateValidMoves(maze, currentLocation);
-        for(auto nextMove : potentialMoves)
-        {
-            GridLocation nextLocation = {nextMove.row, nextMove.col};
-            if(!visited.contains({nextMove.row, nextMove.col}))
-            {
-                visited.add({nextMove.row, nextMove.col});
-                Vector<GridLocation> newPath = currentPath;
-                newPath.add(nextLocation);
-                allPaths.push(newPath);
-            }
-        }
-    }
-
-    return false;
+bool solveMazeDFS(Grid<bool>& maze, Vector<GridLocation>& soln, MazeProgress* progress, SolveStats* stats) {
+    return searchDepthFirst<FourConnected>(GridCells(maze), soln, progress, stats);
 }
 
 /*
- * The given readMazeFile function correctly reads a well-formed
- * maze from a file.
- *
- * This provided function is fully correct. You do not need to change
- * any of the code in this function.
+ * The readMazeFile function reads a well-formed maze from a file, either
+ * in the @/- text format or the binary format from mazeio.h (recognized by
+ * its magic number). The file is memory-mapped and parsed in a single pass
+ * straight into the grid; see parseMazeText and parseMazeBinary.
  */
 void readMazeFile(string filename, Grid<bool>& maze) {
-    /* The following code reads data from the file into a Vector
-     * of strings representing the lines of the file.
-     */
-    ifstream in;
+    FileContents contents;
 
-    if (!openFile(in, filename))
+    if (!contents.open(filename))
         error("Cannot open file named " + filename);
 
-    Vector<string> lines = readLines(in);
-
-    /* Now that the file data has been read into the Vector, populate
-     * the maze grid.
-     */
-    int numRows = lines.size();        // rows is count of lines
-    int numCols = lines[0].length();   // cols is length of line
-    maze.resize(numRows, numCols);     // resize grid dimensions
-
-    for (int r = 0; r < numRows; r++) {
-        if (lines[r].length() != numCols) {
-            error("Maze row has inconsistent number of columns");
-        }
-        for (int c = 0; c < numCols; c++) {
-            char ch = lines[r][c];
-            if (ch == '@') {        // wall
-                maze[r][c] = false;
-            } else if (ch == '-') { // corridor
-                maze[r][c] = true;
-            } else {
-                error("Maze location has invalid character: '" + charToString(ch) + "'");
-            }
-        }
-    }
-    if (!maze[0][0] || !maze[numRows-1][numCols-1]) {
-        error("Maze entrance and exit must be both be open corridors");
+    if (isBinaryMaze(contents.data(), contents.size())) {
+        parseMazeBinary(contents.data(), contents.size(), maze);
+    } else {
+        parseMazeText(contents.data(), contents.size(), maze);
     }
 }
 
@@ -291,6 +267,108 @@ STUDENT_TEST("sovleMazeDFS on hand-constructed maze")
 }
 
 
+/* The stack-of-paths depth-first search, kept as a reference for solveMazeDFS. */
+static bool solveMazeDFSWithPathStack(Grid<bool>& maze, Vector<GridLocation>& soln) {
+    Stack<Vector<GridLocation>> allPaths;
+    Set<GridLocation> visited;
+    allPaths.push({{0, 0}});
+    visited.add({0, 0});
+    while (!allPaths.isEmpty()) {
+        Vector<GridLocation> currentPath = allPaths.pop();
+        GridLocation currentLocation = currentPath[currentPath.size() - 1];
+        if (currentLocation.row == maze.numRows() - 1 && currentLocation.col == maze.numCols() - 1) {
+            soln = currentPath;
+            return true;
+        }
+        for (GridLocation nextMove : generateValidMoves(maze, currentLocation)) {
+            if (!visited.contains(nextMove)) {
+                visited.add(nextMove);
+                Vector<GridLocation> newPath = currentPath;
+                newPath.add(nextMove);
+                allPaths.push(newPath);
+            }
+        }
+    }
+    return false;
+}
+
+STUDENT_TEST("solveMazeDFS finds the same path as a stack of whole paths") {
+    for (string name : {"res/5x7.maze", "res/13x39.maze", "res/19x35.maze", "res/21x23.maze",
+                        "res/25x33.maze", "res/33x41.maze", "res/6x6.maze", "res/24x32.maze"}) {
+        Grid<bool> maze;
+        readMazeFile(name, maze);
+        Vector<GridLocation> expected, soln;
+        EXPECT_EQUAL(solveMazeDFS(maze, soln), solveMazeDFSWithPathStack(maze, expected));
+        EXPECT_EQUAL(soln, expected);
+    }
+    for (MazeStyle style : {MAZE_BACKTRACKER, MAZE_ROOMS}) {
+        Grid<bool> maze;
+        generateMaze(maze, 60, 81, style, 11);
+        Vector<GridLocation> expected, soln;
+        EXPECT(solveMazeDFS(maze, soln));
+        EXPECT(solveMazeDFSWithPathStack(maze, expected));
+        EXPECT_EQUAL(soln, expected);
+    }
+    Grid<bool> open(5, 6, true);   // many choices at every step
+    Vector<GridLocation> expected, soln;
+    EXPECT(solveMazeDFS(open, soln));
+    EXPECT(solveMazeDFSWithPathStack(open, expected));
+    EXPECT_EQUAL(soln, expected);
+}
+
+STUDENT_TEST("solveMazeDFS time, cell stack vs stack of whole paths") {
+    Grid<bool> maze;
+    generateMaze(maze, 201, 201, MAZE_BACKTRACKER);
+    Vector<GridLocation> soln;
+    TIME_OPERATION(maze.numRows() * maze.numCols(), solveMazeDFSWithPathStack(maze, soln));
+    TIME_OPERATION(maze.numRows() * maze.numCols(), solveMazeDFS(maze, soln));
+    generateMaze(maze, 3001, 3001, MAZE_BACKTRACKER);
+    TIME_OPERATION(maze.numRows() * maze.numCols(), solveMazeDFS(maze, soln));
+}
+
+/* The queue-of-paths breadth-first search, kept as a reference for solveMazeBFS. */
+static bool solveMazeBFSWithPathQueue(Grid<bool>& maze, Vector<GridLocation>& soln) {
+    RingQueue<Vector<GridLocation>> allPaths;
+    Set<GridLocation> visited;
+    allPaths.enqueue({{0, 0}});
+    visited.add({0, 0});
+    while (!allPaths.isEmpty()) {
+        Vector<GridLocation> currentPath = allPaths.dequeue();
+        GridLocation current = currentPath[currentPath.size() - 1];
+        if (current.row == maze.numRows() - 1 && current.col == maze.numCols() - 1) {
+            soln = currentPath;
+            return true;
+        }
+        for (GridLocation next : generateValidMoves(maze, current)) {
+            if (!visited.contains(next)) {
+                visited.add(next);
+                Vector<GridLocation> newPath = currentPath;
+                newPath.add(next);
+                allPaths.enqueue(std::move(newPath));
+            }
+        }
+    }
+    return false;
+}
+
+STUDENT_TEST("solveMazeBFS finds the same path as a queue of whole paths") {
+    for (string name : {"res/5x7.maze", "res/21x23.maze", "res/21x35.maze", "res/33x41.maze", "res/6x6.maze"}) {
+        Grid<bool> maze;
+        readMazeFile(name, maze);
+        Vector<GridLocation> soln, expected;
+        EXPECT_EQUAL(solveMazeBFS(maze, soln), solveMazeBFSWithPathQueue(maze, expected));
+        EXPECT_EQUAL(soln, expected);
+    }
+    for (MazeStyle style : {MAZE_BACKTRACKER, MAZE_KRUSKAL, MAZE_ROOMS}) {
+        Grid<bool> maze;
+        generateMaze(maze, 61, 81, style);
+        Vector<GridLocation> soln, expected;
+        EXPECT(solveMazeBFS(maze, soln));
+        EXPECT(solveMazeBFSWithPathQueue(maze, expected));
+        EXPECT_EQUAL(soln, expected);
+    }
+}
+
 STUDENT_TEST("sovleMazeBFS on hand-constructed maze")
 {
     Grid<bool> maze;
@@ -329,6 +407,27 @@ STUDENT_TEST("validatePath on correct solution, hand-constructed 3x3 maze")
     EXPECT_ERROR(validatePath(maze, nonValidMove));
 }
 
+STUDENT_TEST("validatePath catches a loop back onto the exit and validatePaths checks a batch")
+{
+    Grid<bool> maze = {{true, true},
+                       {true, true}};
+    Vector<GridLocation> good = {{0, 0}, {0, 1}, {1, 1}};
+    Vector<GridLocation> loopAtExit = {{0, 0}, {0, 1}, {1, 1}, {1, 0}, {1, 1}};
+    Vector<GridLocation> diagonal = {{0, 0}, {1, 1}};
+    Vector<GridLocation> empty;
+    EXPECT_NO_ERROR(validatePath(maze, good));
+    EXPECT_ERROR(validatePath(maze, loopAtExit));
+    EXPECT_ERROR(validatePath(maze, diagonal));
+
+    Vector<string> problems = validatePaths(maze, {good, loopAtExit, diagonal, empty, good});
+    EXPECT_EQUAL(problems.size(), 5);
+    EXPECT_EQUAL(problems[0], "");
+    EXPECT_EQUAL(problems[1], "Path contains a looped sequence");
+    EXPECT_EQUAL(problems[2], "Path doesn't contain valid moves");
+    EXPECT_EQUAL(problems[3], "Path is empty!");
+    EXPECT_EQUAL(problems[4], "");
+}
+
 STUDENT_TEST("generateValidMoves accesses only one \"step\" away from the current location")
 {
     Grid<bool> maze = {{false, true, false},
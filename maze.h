@@ -2,18 +2,31 @@
 
 #include "grid.h"
 #include "set.h"
+#include "vector.h"
 #include <string>
 
 // Prototypes to be shared with other modules
+// The read, validate and solve functions keep no global state, so they
+// may be called concurrently on different mazes (see mazebatch.h).
+// Only the functions in mazegraphics.h are tied to the GUI thread.
 
 Set<GridLocation> generateValidMoves(Grid<bool>& g, GridLocation cur);
 
 void validatePath(Grid<bool>& g, Vector<GridLocation>& path);
 
+Vector<std::string> validatePaths(Grid<bool>& g, const Vector<Vector<GridLocation>>& paths);
+
 void readMazeFile(std::string filename, Grid<bool>& maze);
 
 void readSolutionFile(std::string filename, Vector<GridLocation>& soln);
 
-bool solveMazeBFS(Grid<bool>& maze, Vector<GridLocation>& soln);
+// The solvers optionally report frontier and visited events to progress (see mazeprogress.h)
+// and record what the solve cost in stats (see mazestats.h)
+class MazeProgress;
+struct SolveStats;
+
+bool solveMazeBFS(Grid<bool>& maze, Vector<GridLocation>& soln, MazeProgress* progress = nullptr,
+                  SolveStats* stats = nullptr);
 
-bool solveMazeDFS(Grid<bool>& maze, Vector<GridLocation>& soln);
+bool solveMazeDFS(Grid<bool>& maze, Vector<GridLocation>& soln, MazeProgress* progress = nullptr,
+                  SolveStats* stats = nullptr);
@@ -0,0 +1,225 @@
+/*
+ * File: mazebatch.cpp
+ * -------------------
+ * Batch maze solving: a fixed pool of worker threads pulls maze files off
+ * a shared counter, and each worker reads, solves and validates its mazes
+ * independently. Nothing here touches mazegraphics, whose state is global
+ * and bound to the Qt GUI thread.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "error.h"
+#include "filelib.h"
+#include "grid.h"
+#include "maze.h"
+#include "mazebatch.h"
+#include "mazeio.h"
+#include "mazestats.h"
+#include "set.h"
+#include "strlib.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+static double millisSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+Vector<string> collectMazeFiles(const Vector<string>& paths) {
+    Vector<string> files;
+    for (const string& path : paths) {
+        if (isDirectory(path)) {
+            for (const string& name : listDirectory(path)) {
+                if (endsWith(name, ".maze") || endsWith(name, ".mazebin")) {
+                    files.add(path + "/" + name);
+                }
+            }
+        } else {
+            files.add(path);
+        }
+    }
+    return files;
+}
+
+/*
+ * Reads, solves and checks a single maze file, filling in result.
+ * Any error() raised while parsing or validating is recorded in the
+ * result rather than propagated, so one bad file doesn't stop the batch.
+ */
+static void solveOneMaze(const string& filename, MazeBatchResult& result) {
+    result.filename = filename;
+    try {
+        auto start = chrono::steady_clock::now();
+        Grid<bool> maze;
+        readMazeFile(filename, maze);
+        result.numRows = maze.numRows();
+        result.numCols = maze.numCols();
+        result.parseMs = millisSince(start);
+
+        start = chrono::steady_clock::now();
+        Vector<GridLocation> soln;
+        result.solved = solveMazeBFS(maze, soln, nullptr, &result.stats);
+        result.solveMs = millisSince(start);
+        result.stats.parseMs = result.parseMs;
+        if (!result.solved) {
+            result.message = "no solution found";
+            return;
+        }
+        result.pathLength = soln.size();
+
+        start = chrono::steady_clock::now();
+        validatePath(maze, soln);
+        string solnFile = getRoot(filename) + ".soln";
+        if (fileExists(solnFile)) {
+            Vector<GridLocation> expected;
+            readSolutionFile(solnFile, expected);
+            validatePath(maze, expected);
+            if (expected.size() < soln.size()) {
+                error("BFS path is longer than the path in " + solnFile);
+            }
+            result.checkedSoln = true;
+        }
+        result.checkMs = millisSince(start);
+        result.ok = true;
+    } catch (ErrorException& e) {
+        result.message = e.getMessage();
+    }
+}
+
+static void printBatchReport(const Vector<MazeBatchResult>& results, int numThreads, double totalMs) {
+    ios::fmtflags oldFlags = cout.flags();
+    streamsize oldPrecision = cout.precision();
+    long totalCells = 0;
+    int numOk = 0;
+    for (const MazeBatchResult& r : results) {
+        cout << left << setw(24) << r.filename << right << fixed << setprecision(3)
+             << "  parse " << setw(9) << r.parseMs << " ms"
+             << "  solve " << setw(9) << r.solveMs << " ms"
+             << "  check " << setw(9) << r.checkMs << " ms"
+             << "  path " << setw(6) << r.pathLength;
+        if (r.ok) {
+            cout << (r.checkedSoln ? "  ok (matched .soln)" : "  ok");
+            numOk++;
+        } else {
+            cout << "  FAILED: " << r.message;
+        }
+        cout << endl;
+        totalCells += long(r.numRows) * r.numCols;
+    }
+    double seconds = totalMs / 1000;
+    cout << numOk << " of " << results.size() << " mazes ok, " << totalCells << " cells in "
+         << setprecision(3) << seconds << " s using " << numThreads << " threads";
+    if (seconds > 0) {
+        cout << " (" << setprecision(1) << results.size() / seconds << " mazes/s, "
+             << totalCells / seconds << " cells/s)";
+    }
+    cout << endl;
+    cout.flags(oldFlags);
+    cout.precision(oldPrecision);
+}
+
+Vector<MazeBatchResult> solveMazeBatch(const Vector<string>& paths, int numThreads, const string& statsFile) {
+    Vector<string> files = collectMazeFiles(paths);
+    Vector<MazeBatchResult> results(files.size());
+    if (numThreads <= 0) {
+        numThreads = max(1, int(thread::hardware_concurrency()));
+    }
+    numThreads = max(1, min(numThreads, files.size()));
+
+    // Workers claim the next unsolved file index; each writes only its own result slot
+    atomic<int> nextFile(0);
+    auto worker = [&]() {
+        for (int i = nextFile++; i < files.size(); i = nextFile++) {
+            solveOneMaze(files[i], results[i]);
+        }
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int t = 0; t < numThreads; t++) {
+        pool.emplace_back(worker);
+    }
+    for (thread& t : pool) {
+        t.join();
+    }
+    printBatchReport(results, numThreads, millisSince(start));
+    if (!statsFile.empty()) {
+        SolveStatsTable table;
+        for (const MazeBatchResult& r : results) {
+            table.add(r.filename, r.stats);
+        }
+        table.writeFile(statsFile);
+    }
+    return results;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("solveMazeBatch solves every maze in res/ and matches the .soln files") {
+    // A binary copy in the directory is picked up and solved like the text mazes
+    convertMazeToBinary("res/33x41.maze", "res/_33x41.mazebin");
+    Vector<MazeBatchResult> results = solveMazeBatch({"res"}, 4);
+    EXPECT_EQUAL(results.size(), collectMazeFiles({"res"}).size());
+    deleteFile("res/_33x41.mazebin");
+
+    // These two have no path from the entry to the exit; every other maze must solve and check out
+    Set<string> unsolvable = {"res/6x6.maze", "res/24x32.maze"};
+    int numChecked = 0;
+    int numBinary = 0;
+    for (const MazeBatchResult& r : results) {
+        EXPECT(endsWith(r.filename, ".maze") || endsWith(r.filename, ".mazebin"));
+        if (unsolvable.contains(r.filename)) {
+            EXPECT(!r.ok);
+            EXPECT_EQUAL(r.message, "no solution found");
+        } else {
+            EXPECT(r.ok);
+        }
+        if (endsWith(r.filename, ".mazebin")) numBinary++;
+        if (r.checkedSoln) numChecked++;
+    }
+    EXPECT_EQUAL(numBinary, 1);
+    EXPECT(numChecked >= 4);
+
+    // a single file solved by one thread gives the same answer as solving directly
+    Grid<bool> maze;
+    Vector<GridLocation> soln;
+    readMazeFile("res/19x35.maze", maze);
+    solveMazeBFS(maze, soln);
+    Vector<MazeBatchResult> single = solveMazeBatch({"res/19x35.maze"}, 1);
+    EXPECT(single[0].ok);
+    EXPECT_EQUAL(single[0].pathLength, soln.size());
+}
+
+STUDENT_TEST("solveMazeBatch records failures without stopping the batch") {
+    Vector<MazeBatchResult> results = solveMazeBatch({"res/5x7.maze", "res/no_such_file.maze", "res/21x23.maze"}, 2);
+    EXPECT_EQUAL(results.size(), 3);
+    EXPECT(results[0].ok);
+    EXPECT(!results[1].ok);
+    EXPECT(!results[1].message.empty());
+    EXPECT(results[2].ok);
+}
+
+STUDENT_TEST("solveMazeBatch writes one stats row per file") {
+    Vector<MazeBatchResult> results = solveMazeBatch({"res/5x7.maze", "res/no_such_file.maze", "res/21x23.maze"}, 2,
+                                                     "res/_batch_stats.csv");
+    ifstream in("res/_batch_stats.csv");
+    Vector<string> lines;
+    for (string line; getline(in, line); ) {
+        lines.add(line);
+    }
+    EXPECT_EQUAL(lines.size(), 4);
+    EXPECT(startsWith(lines[0], "name,nodesExpanded,"));
+    EXPECT(startsWith(lines[1], "res/5x7.maze,"));
+    EXPECT(startsWith(lines[2], "res/no_such_file.maze,0,0,0,"));
+    EXPECT(results[2].stats.nodesExpanded > 0);
+    EXPECT_EQUAL(results[2].stats.pathLength, results[2].pathLength);
+    deleteFile("res/_batch_stats.csv");
+}
@@ -0,0 +1,57 @@
+/*
+ * File: mazebatch.h
+ * -----------------
+ * Defines the batch mode that parses, solves and checks many maze
+ * files at once on a pool of worker threads.
+ */
+
+#pragma once
+
+#include <string>
+#include "mazestats.h"
+#include "vector.h"
+
+/*
+ * The MazeBatchResult struct records the outcome for one maze file.
+ * A file is "ok" when it parsed, was solved, the solution passed
+ * validatePath, and (if a matching .soln file exists) the reference
+ * solution also passed validatePath and was no shorter than ours.
+ * Timings are wall-clock milliseconds measured on the worker thread.
+ * stats holds what the solver recorded about its search (see mazestats.h).
+ */
+struct MazeBatchResult {
+    std::string filename;
+    bool ok = false;
+    bool solved = false;
+    bool checkedSoln = false;   // true if a .soln file was found and compared
+    std::string message;        // reason for failure, empty when ok
+    int numRows = 0;
+    int numCols = 0;
+    int pathLength = 0;
+    double parseMs = 0;
+    double solveMs = 0;
+    double checkMs = 0;
+    SolveStats stats;
+};
+
+/*
+ * The collectMazeFiles function expands a list of paths into the list of
+ * maze files to solve. A path naming a directory contributes every .maze
+ * and .mazebin (binary, see mazeio.h) file directly inside it in sorted
+ * order; any other path is taken as is.
+ */
+Vector<std::string> collectMazeFiles(const Vector<std::string>& paths);
+
+/*
+ * The solveMazeBatch function solves every maze file named by paths (files
+ * or directories, see collectMazeFiles) using numThreads worker threads,
+ * or one per hardware core if numThreads is 0. Each worker reads, solves
+ * with solveMazeBFS and validates its own mazes; the graphics window is
+ * never touched. Per-file timings and the aggregate throughput are printed
+ * to cout once all files are done, and the results are returned in the
+ * same order as the files were listed. If statsFile is not empty, the
+ * solver stats of every file are also written to it, as JSON if its name
+ * ends in .json and as CSV otherwise.
+ */
+Vector<MazeBatchResult> solveMazeBatch(const Vector<std::string>& paths, int numThreads = 0,
+                                       const std::string& statsFile = "");
@@ -0,0 +1,435 @@
+/*
+ * File: mazedistance.cpp
+ * ----------------------
+ * Distance fields and landmark (ALT) queries over a flattened copy of the
+ * maze. Cells are numbered row * numCols + col. The distances are stored
+ * cell-major, so all landmark distances for one cell (which are read
+ * together by every bound) share a cache line: landmark i's distance to
+ * cell c is at c * numLandmarks + i. The parent directions are stored
+ * landmark-major since a path walk only ever reads one landmark's. They
+ * are 2 bits each (0 north, 1 west, 2 east, 3 south) and point from a
+ * cell one step closer to the landmark.
+ */
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+#include "error.h"
+#include "grid.h"
+#include "maze.h"
+#include "mazedistance.h"
+#include "mazegenerator.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+static const int kRowStep[4] = {-1, 0, 0, 1};
+static const int kColStep[4] = {0, -1, 1, 0};
+
+// Beyond this many cached query results the cache is emptied and starts over.
+static const size_t kMaxCacheEntries = 1 << 20;
+
+/*
+ * Breadth-first search from all of sources over the open cells. Fills dist
+ * with move counts (UINT32_MAX where unreached) and, if parents is not
+ * null, the direction from each reached cell towards its parent.
+ */
+static void searchFrom(int rows, int cols, const vector<unsigned char>& open, const vector<int>& sources,
+                       vector<uint32_t>& dist, vector<unsigned char>* parents) {
+    long numCells = long(rows) * cols;
+    dist.assign(numCells, UINT32_MAX);
+    if (parents) parents->assign(numCells, 0);
+    vector<int> queue;
+    queue.reserve(numCells);
+    for (int source : sources) {
+        if (dist[source] == UINT32_MAX) {
+            dist[source] = 0;
+            queue.push_back(source);
+        }
+    }
+    for (size_t next = 0; next < queue.size(); next++) {
+        int cell = queue[next];
+        int row = cell / cols;
+        int col = cell - row * cols;
+        for (int dir = 0; dir < 4; dir++) {
+            int r = row + kRowStep[dir];
+            int c = col + kColStep[dir];
+            if (r < 0 || r >= rows || c < 0 || c >= cols) continue;
+            int neighbor = r * cols + c;
+            if (!open[neighbor] || dist[neighbor] != UINT32_MAX) continue;
+            dist[neighbor] = dist[cell] + 1;
+            if (parents) (*parents)[neighbor] = 3 - dir;   // opposite direction, back to cell
+            queue.push_back(neighbor);
+        }
+    }
+}
+
+static vector<unsigned char> flatten(const Grid<bool>& maze) {
+    vector<unsigned char> open;
+    open.reserve(long(maze.numRows()) * maze.numCols());
+    for (bool isOpen : maze) {
+        open.push_back(isOpen);
+    }
+    return open;
+}
+
+void computeDistanceField(const Grid<bool>& maze, const Vector<GridLocation>& sources, Grid<int>& distances) {
+    vector<unsigned char> open = flatten(maze);
+    vector<int> cells;
+    for (const GridLocation& loc : sources) {
+        if (!maze.inBounds(loc)) error("computeDistanceField: source is outside the maze");
+        if (maze[loc]) cells.push_back(loc.row * maze.numCols() + loc.col);
+    }
+    vector<uint32_t> dist;
+    searchFrom(maze.numRows(), maze.numCols(), open, cells, dist, nullptr);
+    distances.resize(maze.numRows(), maze.numCols());
+    auto out = distances.begin();
+    for (uint32_t d : dist) {
+        *out = (d == UINT32_MAX) ? -1 : int(d);
+        ++out;
+    }
+}
+
+Vector<GridLocation> chooseLandmarks(const Grid<bool>& maze, int count) {
+    Vector<GridLocation> landmarks;
+    vector<unsigned char> open = flatten(maze);
+    auto first = find(open.begin(), open.end(), 1);
+    if (first == open.end() || count <= 0) return landmarks;
+
+    int cols = maze.numCols();
+    vector<int> chosen = {int(first - open.begin())};
+    vector<uint32_t> dist;
+    while (int(chosen.size()) < count) {
+        searchFrom(maze.numRows(), cols, open, chosen, dist, nullptr);
+        // Prefer a cell in a component no landmark reaches yet, else the farthest one.
+        int best = -1;
+        for (size_t cell = 0; cell < dist.size(); cell++) {
+            if (open[cell] && dist[cell] > 0 && (best < 0 || dist[cell] > dist[best])) best = cell;
+        }
+        if (best < 0) break;   // every open cell is already a landmark
+        chosen.push_back(best);
+    }
+    for (int cell : chosen) {
+        landmarks.add({cell / cols, cell % cols});
+    }
+    return landmarks;
+}
+
+MazeDistanceOracle::MazeDistanceOracle(const Grid<bool>& maze, const Vector<GridLocation>& landmarks, bool storeParents)
+    : _rows(maze.numRows()), _cols(maze.numCols()), _open(flatten(maze)), _numExpanded(0) {
+    size_t numCells = _open.size();
+    bool narrow = numCells < UINT16_MAX;   // every distance is below numCells
+    size_t numLandmarks = landmarks.size();
+    if (narrow) {
+        _narrow.resize(numCells * numLandmarks);
+    } else {
+        _wide.resize(numCells * numLandmarks);
+    }
+    if (storeParents) _parents.assign((numCells * landmarks.size() + 3) / 4, 0);
+
+    vector<uint32_t> dist;
+    vector<unsigned char> parents;
+    for (const GridLocation& loc : landmarks) {
+        if (!maze.inBounds(loc) || !maze[loc]) {
+            error("MazeDistanceOracle: landmark (" + to_string(loc.row) + ", " + to_string(loc.col)
+                  + ") is not an open location");
+        }
+        int cell = cellOf(loc);
+        searchFrom(_rows, _cols, _open, {cell}, dist, storeParents ? &parents : nullptr);
+        size_t landmark = _landmarks.size();
+        for (size_t i = 0; i < numCells; i++) {
+            if (narrow) {
+                _narrow[i * numLandmarks + landmark] = (dist[i] == UINT32_MAX) ? UINT16_MAX : uint16_t(dist[i]);
+            } else {
+                _wide[i * numLandmarks + landmark] = dist[i];
+            }
+        }
+        if (storeParents) {
+            size_t base = landmark * numCells;
+            for (size_t i = 0; i < numCells; i++) {
+                _parents[(base + i) / 4] |= parents[i] << (2 * ((base + i) % 4));
+            }
+        }
+        _landmarks.push_back(cell);
+    }
+    _gScore.assign(numCells, -1);
+    _cameFrom.assign(numCells, -1);
+}
+
+int MazeDistanceOracle::numLandmarks() const {
+    return _landmarks.size();
+}
+
+long MazeDistanceOracle::numExpanded() const {
+    return _numExpanded;
+}
+
+int MazeDistanceOracle::cellOf(GridLocation loc) const {
+    if (loc.row < 0 || loc.row >= _rows || loc.col < 0 || loc.col >= _cols) {
+        error("MazeDistanceOracle: location (" + to_string(loc.row) + ", " + to_string(loc.col)
+              + ") is outside the maze");
+    }
+    return loc.row * _cols + loc.col;
+}
+
+uint32_t MazeDistanceOracle::landmarkDistance(int landmark, int cell) const {
+    size_t i = size_t(cell) * _landmarks.size() + landmark;
+    if (_narrow.empty()) return _wide[i];
+    return _narrow[i] == UINT16_MAX ? kUnreachable : _narrow[i];
+}
+
+int MazeDistanceOracle::landmarkAt(int cell) const {
+    for (size_t i = 0; i < _landmarks.size(); i++) {
+        if (_landmarks[i] == cell) return i;
+    }
+    return -1;
+}
+
+/* Returns a lower bound on the distance between cells a and b, or INT_MAX if they are disconnected. */
+int MazeDistanceOracle::boundFor(int a, int b) const {
+    int bound = abs(a / _cols - b / _cols) + abs(a % _cols - b % _cols);
+    for (size_t i = 0; i < _landmarks.size(); i++) {
+        uint32_t da = landmarkDistance(i, a);
+        uint32_t db = landmarkDistance(i, b);
+        if (da == kUnreachable && db == kUnreachable) continue;
+        if (da == kUnreachable || db == kUnreachable) return INT_MAX;
+        bound = max(bound, int(da > db ? da - db : db - da));
+    }
+    return bound;
+}
+
+int MazeDistanceOracle::lowerBound(GridLocation a, GridLocation b) const {
+    return boundFor(cellOf(a), cellOf(b));
+}
+
+/* Appends the locations from cell to the landmark (both included) to path. */
+void MazeDistanceOracle::walkToLandmark(int landmark, int cell, Vector<GridLocation>& path) const {
+    size_t base = size_t(landmark) * _open.size();
+    int goal = _landmarks[landmark];
+    path.add({cell / _cols, cell % _cols});
+    while (cell != goal) {
+        int dir = (_parents[(base + cell) / 4] >> (2 * ((base + cell) % 4))) & 3;
+        cell += kRowStep[dir] * _cols + kColStep[dir];
+        path.add({cell / _cols, cell % _cols});
+    }
+}
+
+/*
+ * A* from start to goal using boundFor as the heuristic. Landmark bounds
+ * and the Manhattan distance are both consistent, and so is their maximum,
+ * so a cell's score is final the first time it is taken off the queue.
+ * Returns the distance (and fills path if it isn't null), or -1.
+ */
+int MazeDistanceOracle::search(int start, int goal, Vector<GridLocation>* path) {
+    struct Entry {
+        int f;
+        int g;
+        int cell;
+        bool operator<(const Entry& other) const {   // lowest f first, then deepest
+            return f != other.f ? f > other.f : g < other.g;
+        }
+    };
+    _numExpanded = 0;
+    int startBound = boundFor(start, goal);
+    if (startBound == INT_MAX) return -1;
+
+    priority_queue<Entry> open;
+    open.push({startBound, 0, start});
+    _gScore[start] = 0;
+    _touched.push_back(start);
+    int result = -1;
+    while (!open.empty()) {
+        Entry top = open.top();
+        open.pop();
+        if (top.g != _gScore[top.cell]) continue;   // superseded by a shorter route
+        _numExpanded++;
+        if (top.cell == goal) {
+            result = top.g;
+            break;
+        }
+        int row = top.cell / _cols;
+        int col = top.cell - row * _cols;
+        for (int dir = 0; dir < 4; dir++) {
+            int r = row + kRowStep[dir];
+            int c = col + kColStep[dir];
+            if (r < 0 || r >= _rows || c < 0 || c >= _cols) continue;
+            int neighbor = r * _cols + c;
+            if (!_open[neighbor]) continue;
+            int g = top.g + 1;
+            if (_gScore[neighbor] >= 0 && _gScore[neighbor] <= g) continue;
+            if (_gScore[neighbor] < 0) _touched.push_back(neighbor);
+            _gScore[neighbor] = g;
+            _cameFrom[neighbor] = top.cell;
+            open.push({g + boundFor(neighbor, goal), g, neighbor});
+        }
+    }
+
+    if (result >= 0 && path) {
+        for (int cell = goal; cell != start; cell = _cameFrom[cell]) {
+            path->add({cell / _cols, cell % _cols});
+        }
+        path->add({start / _cols, start % _cols});
+        reverse(path->begin(), path->end());
+    }
+    for (int cell : _touched) {
+        _gScore[cell] = -1;
+    }
+    _touched.clear();
+    return result;
+}
+
+int MazeDistanceOracle::distance(GridLocation start, GridLocation goal) {
+    int a = cellOf(start);
+    int b = cellOf(goal);
+    if (!_open[a] || !_open[b]) return -1;
+    if (a == b) return 0;
+    int landmark = landmarkAt(a);
+    int other = b;
+    if (landmark < 0) {
+        landmark = landmarkAt(b);
+        other = a;
+    }
+    if (landmark >= 0) {
+        uint32_t d = landmarkDistance(landmark, other);
+        return d == kUnreachable ? -1 : int(d);
+    }
+
+    uint64_t key = uint64_t(min(a, b)) * _open.size() + max(a, b);
+    auto cached = _cache.find(key);
+    if (cached != _cache.end()) return cached->second;
+    int d = search(a, b, nullptr);
+    if (_cache.size() >= kMaxCacheEntries) _cache.clear();
+    _cache[key] = d;
+    return d;
+}
+
+bool MazeDistanceOracle::findPath(GridLocation start, GridLocation goal, Vector<GridLocation>& path) {
+    path.clear();
+    int a = cellOf(start);
+    int b = cellOf(goal);
+    if (!_open[a] || !_open[b]) return false;
+    if (!_parents.empty()) {
+        int landmark = landmarkAt(b);
+        if (landmark >= 0) {
+            if (landmarkDistance(landmark, a) == kUnreachable) return false;
+            walkToLandmark(landmark, a, path);
+            return true;
+        }
+        landmark = landmarkAt(a);
+        if (landmark >= 0) {
+            if (landmarkDistance(landmark, b) == kUnreachable) return false;
+            walkToLandmark(landmark, b, path);
+            reverse(path.begin(), path.end());
+            return true;
+        }
+    }
+    return search(a, b, &path) >= 0;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Checks that path is a sequence of single moves through open locations from start to goal. */
+static bool isPathBetween(const Grid<bool>& maze, const Vector<GridLocation>& path, GridLocation start, GridLocation goal) {
+    if (path.isEmpty() || path[0] != start || path[path.size() - 1] != goal) return false;
+    for (int i = 0; i < path.size(); i++) {
+        if (!maze.inBounds(path[i]) || !maze[path[i]]) return false;
+        if (i > 0 && abs(path[i].row - path[i - 1].row) + abs(path[i].col - path[i - 1].col) != 1) return false;
+    }
+    return true;
+}
+
+/* Returns the open locations of maze in row-major order. */
+static Vector<GridLocation> openLocations(const Grid<bool>& maze) {
+    Vector<GridLocation> open;
+    for (const GridLocation& loc : maze.locations()) {
+        if (maze[loc]) open.add(loc);
+    }
+    return open;
+}
+
+STUDENT_TEST("computeDistanceField from one and from several sources") {
+    Grid<bool> maze = {{true, true, true},
+                       {false, false, true},
+                       {true, true, true},
+                       {true, false, false}};
+    Grid<int> distances;
+    computeDistanceField(maze, {{0, 0}}, distances);
+    Grid<int> expected = {{0, 1, 2}, {-1, -1, 3}, {6, 5, 4}, {7, -1, -1}};
+    EXPECT_EQUAL(distances, expected);
+
+    computeDistanceField(maze, {{0, 0}, {3, 0}}, distances);
+    expected = {{0, 1, 2}, {-1, -1, 3}, {1, 2, 3}, {0, -1, -1}};
+    EXPECT_EQUAL(distances, expected);
+    EXPECT_ERROR(computeDistanceField(maze, {{4, 0}}, distances));
+}
+
+STUDENT_TEST("MazeDistanceOracle agrees with BFS for arbitrary pairs on a maze with loops") {
+    Grid<bool> maze;
+    generateMaze(maze, 41, 61, MAZE_ROOMS, 5);
+    Vector<GridLocation> open = openLocations(maze);
+    for (bool storeParents : {true, false}) {
+        MazeDistanceOracle oracle(maze, chooseLandmarks(maze, 4), storeParents);
+        EXPECT_EQUAL(oracle.numLandmarks(), 4);
+        for (int i = 0; i < 60; i++) {
+            GridLocation start = open[(i * 7919) % open.size()];
+            GridLocation goal = open[(i * 104729 + 13) % open.size()];
+            if (i % 10 == 0) goal = {0, 0};   // a landmark
+            Grid<int> expected;
+            computeDistanceField(maze, {start}, expected);
+            EXPECT_EQUAL(oracle.distance(start, goal), expected[goal]);
+            EXPECT_EQUAL(oracle.distance(goal, start), expected[goal]);
+            EXPECT(oracle.lowerBound(start, goal) <= expected[goal]);
+            Vector<GridLocation> path;
+            EXPECT(oracle.findPath(start, goal, path));
+            EXPECT_EQUAL(path.size(), expected[goal] + 1);
+            EXPECT(isPathBetween(maze, path, start, goal));
+        }
+    }
+}
+
+STUDENT_TEST("MazeDistanceOracle reports disconnected locations and walls") {
+    Grid<bool> maze;
+    readMazeFile("res/6x6.maze", maze);   // no path from entry to exit
+    MazeDistanceOracle oracle(maze, chooseLandmarks(maze, 3));
+    GridLocation exit = {5, 5};
+    Vector<GridLocation> path = {{0, 0}};
+    EXPECT_EQUAL(oracle.distance({0, 0}, exit), -1);
+    EXPECT(!oracle.findPath({0, 0}, exit, path));
+    EXPECT(path.isEmpty());
+    EXPECT_ERROR(oracle.distance({0, 0}, {6, 0}));
+    EXPECT_ERROR(MazeDistanceOracle(maze, {{6, 6}}));
+
+    Grid<bool> walled = {{true, false}, {false, true}};
+    MazeDistanceOracle walledOracle(walled, {{0, 0}});
+    EXPECT_EQUAL(walledOracle.distance({0, 0}, {0, 1}), -1);
+    EXPECT_EQUAL(walledOracle.distance({1, 1}, {1, 1}), 0);
+}
+
+STUDENT_TEST("Time 200 oracle queries vs one BFS per query on a 1001x1001 maze") {
+    Grid<bool> maze;
+    generateMaze(maze, 1001, 1001, MAZE_ROOMS);
+    Vector<GridLocation> open = openLocations(maze);
+    Vector<GridLocation> landmarks;
+    TIME_OPERATION(8, landmarks = chooseLandmarks(maze, 8));
+    MazeDistanceOracle* oracle = nullptr;
+    TIME_OPERATION(landmarks.size(), oracle = new MazeDistanceOracle(maze, landmarks));
+
+    long total = 0;
+    long expanded = 0;
+    TIME_OPERATION(200, for (int i = 0; i < 200; i++) {
+        total += oracle->distance(open[(i * 7919L) % open.size()], open[(i * 104729L + 13) % open.size()]);
+        expanded += oracle->numExpanded();
+    });
+    EXPECT(expanded / 200 < open.size() / 10);   // the landmark bounds prune most of the maze
+    TIME_OPERATION(200, for (int i = 0; i < 200; i++) {
+        total -= oracle->distance(open[(i * 7919L) % open.size()], open[(i * 104729L + 13) % open.size()]);
+    });
+    EXPECT_EQUAL(total, 0);   // second pass is answered from the cache
+
+    Grid<int> distances;
+    TIME_OPERATION(10, for (int i = 0; i < 10; i++) computeDistanceField(maze, {open[i * 7919L % open.size()]}, distances));
+    delete oracle;
+}
@@ -0,0 +1,94 @@
+/*
+ * File: mazedistance.h
+ * --------------------
+ * Defines precomputed BFS distance fields for answering many shortest-path
+ * queries against one maze, with any start and goal, without a full search
+ * for each query.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "grid.h"
+#include "vector.h"
+
+/*
+ * The computeDistanceField function runs one breadth-first search from all
+ * of sources at once and fills distances (resized to match maze) with the
+ * number of moves from each location to its nearest source, or -1 where no
+ * source can be reached. Walls always get -1.
+ */
+void computeDistanceField(const Grid<bool>& maze, const Vector<GridLocation>& sources, Grid<int>& distances);
+
+/*
+ * The chooseLandmarks function picks count open locations that are spread
+ * out across the maze: the entry first, then each following landmark is
+ * the location farthest (by path length) from all those chosen so far.
+ * Spread-out landmarks give the tightest lower bounds in MazeDistanceOracle.
+ */
+Vector<GridLocation> chooseLandmarks(const Grid<bool>& maze, int count);
+
+/*
+ * The MazeDistanceOracle class answers shortest-path queries on a fixed
+ * maze. The constructor runs one BFS per landmark and keeps the distance
+ * field (2 bytes per location when distances fit, 4 otherwise) and, if
+ * storeParents is true, a packed 2-bit direction towards the landmark.
+ *
+ * A query with a landmark at either end is answered from the field alone:
+ * distance is a lookup and findPath walks the parent directions. Any other
+ * query runs A* guided by the landmark (ALT) lower bound
+ *     |d(L, a) - d(L, b)| <= d(a, b)    for every landmark L,
+ * which also proves two locations disconnected without any search when a
+ * landmark reaches one but not the other. Distances found by A* are cached.
+ *
+ * Queries reuse scratch space inside the oracle, so one oracle must not be
+ * queried from several threads at once; build one oracle per thread.
+ */
+class MazeDistanceOracle {
+public:
+    MazeDistanceOracle(const Grid<bool>& maze, const Vector<GridLocation>& landmarks, bool storeParents = true);
+
+    int numLandmarks() const;
+
+    /* Returns the number of moves on a shortest path from start to goal, or -1 if there is none. */
+    int distance(GridLocation start, GridLocation goal);
+
+    /*
+     * Stores a shortest path from start to goal (both ends included) in path
+     * and returns true, or clears path and returns false if there is none.
+     */
+    bool findPath(GridLocation start, GridLocation goal, Vector<GridLocation>& path);
+
+    /* Returns a lower bound on distance(a, b): the best landmark bound or the Manhattan distance. */
+    int lowerBound(GridLocation a, GridLocation b) const;
+
+    /* Returns the number of locations A* expanded in the most recent query that needed a search. */
+    long numExpanded() const;
+
+private:
+    static const uint32_t kUnreachable = UINT32_MAX;
+
+    int cellOf(GridLocation loc) const;
+    uint32_t landmarkDistance(int landmark, int cell) const;
+    int landmarkAt(int cell) const;
+    int boundFor(int a, int b) const;
+    void walkToLandmark(int landmark, int cell, Vector<GridLocation>& path) const;
+    int search(int start, int goal, Vector<GridLocation>* path);
+
+    int _rows;
+    int _cols;
+    std::vector<unsigned char> _open;
+    std::vector<int> _landmarks;          // cell numbers
+    std::vector<uint16_t> _narrow;        // cell-major distance fields, when they fit in 16 bits
+    std::vector<uint32_t> _wide;          // otherwise
+    std::vector<unsigned char> _parents;  // 2 bits per cell per landmark, empty if not stored
+    std::unordered_map<uint64_t, int> _cache;
+
+    // A* scratch space, reset after each search
+    std::vector<int> _gScore;
+    std::vector<int> _cameFrom;
+    std::vector<int> _touched;
+    long _numExpanded;
+};
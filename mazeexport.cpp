@@ -0,0 +1,277 @@
+/*
+ * File: mazeexport.cpp
+ * --------------------
+ * Headless maze export. The path is copied and sorted into row-major order
+ * once, then each output row is produced by merging the maze row with the
+ * path locations that fall in it. The PNG writer streams the image as
+ * uncompressed ("stored") deflate blocks, so it needs no compression
+ * library and never holds more than one block of image data.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "error.h"
+#include "filelib.h"
+#include "grid.h"
+#include "mazeexport.h"
+#include "strlib.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+enum CellKind : unsigned char { WALL_CELL, CORRIDOR_CELL, PATH_CELL };
+
+// Image colors, indexed by CellKind
+static const unsigned char kCellRGB[3][3] = {
+    {0x59, 0x59, 0x59},   // wall: dark gray
+    {0xFF, 0xFF, 0xFF},   // corridor: white
+    {0x33, 0xCC, 0x33}    // path: green
+};
+
+/*
+ * Produces the maze one row at a time as a vector of CellKind, with the
+ * path locations overlaid.
+ */
+class MazeRowReader {
+public:
+    MazeRowReader(const Grid<bool>& maze, const Vector<GridLocation>& path)
+        : _maze(maze), _path(path.begin(), path.end()), _next(0), _row(maze.numCols()) {
+        sort(_path.begin(), _path.end(), [](const GridLocation& a, const GridLocation& b) {
+            return a.row < b.row || (a.row == b.row && a.col < b.col);
+        });
+    }
+
+    /* Returns the kinds of the cells in row r; rows must be read in increasing order. */
+    const vector<unsigned char>& read(int r) {
+        for (int c = 0; c < _maze.numCols(); c++) {
+            _row[c] = _maze[r][c] ? CORRIDOR_CELL : WALL_CELL;
+        }
+        while (_next < _path.size() && _path[_next].row < r) _next++;
+        for (; _next < _path.size() && _path[_next].row == r; _next++) {
+            if (_maze.inBounds(_path[_next])) _row[_path[_next].col] = PATH_CELL;
+        }
+        return _row;
+    }
+
+private:
+    const Grid<bool>& _maze;
+    vector<GridLocation> _path;
+    size_t _next;
+    vector<unsigned char> _row;
+};
+
+void writeMazeText(ostream& out, const Grid<bool>& maze, const Vector<GridLocation>& path, bool ansiColor) {
+    static const char kChars[3] = {'@', ' ', '+'};
+    static const char* kAnsiBackground[3] = {"\033[48;5;240m", "\033[48;5;255m", "\033[48;5;34m"};
+    MazeRowReader reader(maze, path);
+    string line;
+    for (int r = 0; r < maze.numRows(); r++) {
+        const vector<unsigned char>& row = reader.read(r);
+        line.clear();
+        int lastKind = -1;
+        for (unsigned char kind : row) {
+            if (ansiColor) {
+                if (kind != lastKind) line += kAnsiBackground[kind];
+                line += "  ";
+                lastKind = kind;
+            } else {
+                line += "  ";
+                line += kChars[kind];
+            }
+        }
+        if (ansiColor) line += "\033[0m";
+        line += '\n';
+        out.write(line.data(), line.size());
+    }
+    out.flush();
+}
+
+/*
+ * Writes a PNG as a sequence of IDAT chunks, each holding one stored
+ * deflate block of at most 65535 bytes of scanline data.
+ */
+class PngStreamWriter {
+public:
+    PngStreamWriter(ostream& out, uint32_t width, uint32_t height) : _out(out), _adlerA(1), _adlerB(0), _first(true) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            _crcTable[n] = c;
+        }
+        static const char kSignature[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+        _out.write(kSignature, sizeof(kSignature));
+
+        string header;
+        appendUint32(header, width);
+        appendUint32(header, height);
+        header += char(8);    // bit depth
+        header += char(3);    // color type: palette
+        header += string(3, '\0');   // compression, filter, interlace
+        writeChunk("IHDR", header);
+
+        string palette;
+        for (const auto& rgb : kCellRGB) palette.append(reinterpret_cast<const char*>(rgb), 3);
+        writeChunk("PLTE", palette);
+        _block.reserve(kMaxBlock);
+    }
+
+    /* Adds one scanline (filter type 0 followed by one palette index per pixel). */
+    void addScanline(const string& pixels) {
+        addByte(0);
+        for (char ch : pixels) addByte(ch);
+    }
+
+    void finish() {
+        flushBlock(true);
+        writeChunk("IEND", "");
+    }
+
+private:
+    static const size_t kMaxBlock = 65535;
+
+    void addByte(char ch) {
+        _adlerA = (_adlerA + (unsigned char) ch) % 65521;
+        _adlerB = (_adlerB + _adlerA) % 65521;
+        _block += ch;
+        if (_block.size() == kMaxBlock) flushBlock(false);
+    }
+
+    void flushBlock(bool last) {
+        string data;
+        if (_first) {
+            data += "\x78\x01";   // zlib header: deflate, 32K window, no dictionary
+            _first = false;
+        }
+        uint16_t length = _block.size();
+        data += char(last ? 1 : 0);
+        data += char(length & 0xFF);
+        data += char(length >> 8);
+        data += char(~length & 0xFF);
+        data += char((~length >> 8) & 0xFF);
+        data += _block;
+        if (last) appendUint32(data, (_adlerB << 16) | _adlerA);
+        writeChunk("IDAT", data);
+        _block.clear();
+    }
+
+    void writeChunk(const string& type, const string& data) {
+        string length;
+        appendUint32(length, data.size());
+        _out.write(length.data(), 4);
+        uint32_t crc = 0xFFFFFFFFu;
+        for (char ch : type + data) crc = _crcTable[(crc ^ (unsigned char) ch) & 0xFF] ^ (crc >> 8);
+        string crcBytes;
+        appendUint32(crcBytes, crc ^ 0xFFFFFFFFu);
+        _out.write(type.data(), 4);
+        _out.write(data.data(), data.size());
+        _out.write(crcBytes.data(), 4);
+    }
+
+    static void appendUint32(string& s, uint32_t value) {
+        s += char(value >> 24);
+        s += char(value >> 16);
+        s += char(value >> 8);
+        s += char(value);
+    }
+
+    ostream& _out;
+    uint32_t _crcTable[256];
+    uint32_t _adlerA;
+    uint32_t _adlerB;
+    bool _first;
+    string _block;
+};
+
+void writeMazeImage(string filename, const Grid<bool>& maze, const Vector<GridLocation>& path, int cellPixels) {
+    string extension = toLowerCase(getExtension(filename));
+    if (extension != ".png" && extension != ".ppm") {
+        error("writeMazeImage: unsupported image type '" + extension + "', use .png or .ppm");
+    }
+    if (cellPixels < 1) cellPixels = 1;
+    ofstream out(filename, ios::binary);
+    if (!out) error("Cannot open file named " + filename);
+
+    uint32_t width = uint32_t(maze.numCols()) * cellPixels;
+    uint32_t height = uint32_t(maze.numRows()) * cellPixels;
+    MazeRowReader reader(maze, path);
+    if (extension == ".ppm") {
+        out << "P6\n" << width << " " << height << "\n255\n";
+        string scanline(3 * size_t(width), '\0');
+        for (int r = 0; r < maze.numRows(); r++) {
+            const vector<unsigned char>& row = reader.read(r);
+            for (size_t x = 0; x < width; x++) {
+                memcpy(&scanline[3 * x], kCellRGB[row[x / cellPixels]], 3);
+            }
+            for (int i = 0; i < cellPixels; i++) out.write(scanline.data(), scanline.size());
+        }
+    } else {
+        PngStreamWriter png(out, width, height);
+        string scanline(width, '\0');
+        for (int r = 0; r < maze.numRows(); r++) {
+            const vector<unsigned char>& row = reader.read(r);
+            for (size_t x = 0; x < width; x++) scanline[x] = char(row[x / cellPixels]);
+            for (int i = 0; i < cellPixels; i++) png.addScanline(scanline);
+        }
+        png.finish();
+    }
+    if (!out) error("Error writing image file " + filename);
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("writeMazeText matches the printMaze layout and supports ANSI colors") {
+    Grid<bool> maze = {{true, false, false},
+                       {true, true, true}};
+    Vector<GridLocation> path = {{0, 0}, {1, 0}, {1, 1}, {1, 2}};
+    ostringstream plain;
+    writeMazeText(plain, maze, path);
+    EXPECT_EQUAL(plain.str(), "  +  @  @\n  +  +  +\n");
+
+    ostringstream unsolved;
+    writeMazeText(unsolved, maze, {});
+    EXPECT_EQUAL(unsolved.str(), "     @  @\n         \n");
+
+    ostringstream ansi;
+    writeMazeText(ansi, maze, path, true);
+    string colored = ansi.str();
+    EXPECT(colored.find("\033[48;5;240m") != string::npos);
+    EXPECT_EQUAL(int(count(colored.begin(), colored.end(), '\n')), 2);
+}
+
+STUDENT_TEST("writeMazeImage writes PPM and PNG files of the expected size") {
+    Grid<bool> maze = {{true, false, false},
+                       {true, true, true}};
+    Vector<GridLocation> path = {{0, 0}, {1, 0}, {1, 1}, {1, 2}};
+    writeMazeImage("res/_export.ppm", maze, path, 2);
+    ifstream ppm("res/_export.ppm", ios::binary);
+    string contents((istreambuf_iterator<char>(ppm)), istreambuf_iterator<char>());
+    EXPECT(startsWith(contents, "P6\n6 4\n255\n"));
+    EXPECT_EQUAL(int(contents.size()), 11 + 6 * 4 * 3);
+
+    writeMazeImage("res/_export.png", maze, path, 2);
+    ifstream png("res/_export.png", ios::binary);
+    contents.assign((istreambuf_iterator<char>(png)), istreambuf_iterator<char>());
+    EXPECT(startsWith(contents, "\x89PNG\r\n\x1a\n"));
+    // signature + IHDR + PLTE + one IDAT (zlib header, block header, 4 rows of 1+6 bytes, adler) + IEND
+    EXPECT_EQUAL(int(contents.size()), 8 + 25 + 21 + (12 + 2 + 5 + 28 + 4) + 12);
+
+    deleteFile("res/_export.ppm");
+    deleteFile("res/_export.png");
+    EXPECT_ERROR(writeMazeImage("res/_export.gif", maze, path));
+}
+
+STUDENT_TEST("writeMazeImage time for a 4000x4000 maze") {
+    Grid<bool> maze(4000, 4000, true);
+    Vector<GridLocation> path;
+    for (int c = 0; c < 4000; c++) path.add({0, c});
+    for (int r = 1; r < 4000; r++) path.add({r, 3999});
+    TIME_OPERATION(maze.numRows() * maze.numCols(), writeMazeImage("res/_large.png", maze, path));
+    deleteFile("res/_large.png");
+}
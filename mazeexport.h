@@ -0,0 +1,36 @@
+/*
+ * File: mazeexport.h
+ * ------------------
+ * Defines export of a maze and its solution path as text or as an image,
+ * without needing a graphics window. Output is produced one row at a time,
+ * so memory use depends on the maze width and path length, not the maze
+ * area.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include "grid.h"
+#include "vector.h"
+
+/*
+ * The writeMazeText function writes maze to out in the same layout as
+ * printMaze: each location takes three characters, '@' for a wall, space
+ * for a corridor, and '+' for a location on path. If ansiColor is true the
+ * maze is instead drawn as colored blocks using ANSI terminal escapes
+ * (two columns per location), which is easier to read for large mazes.
+ */
+void writeMazeText(std::ostream& out, const Grid<bool>& maze, const Vector<GridLocation>& path,
+                   bool ansiColor = false);
+
+/*
+ * The writeMazeImage function writes maze as an image file with each
+ * location drawn as a cellPixels x cellPixels square: dark gray walls,
+ * white corridors and a green path. The format is chosen from the file
+ * extension: ".png" for PNG (palette colors, uncompressed so that it
+ * can be streamed) or ".ppm" for binary PPM. Calls error() for any other
+ * extension or if the file can't be written.
+ */
+void writeMazeImage(std::string filename, const Grid<bool>& maze, const Vector<GridLocation>& path,
+                    int cellPixels = 1);
@@ -0,0 +1,322 @@
+/*
+ * File: mazegenerator.cpp
+ * -----------------------
+ * Maze generators working on a flat byte array of the maze (1 = corridor),
+ * copied into the Grid at the end. Generators see the maze as a lattice of
+ * "cells" at even coordinates, numbered cellRow * cellCols + cellCol, and
+ * carve the wall position between two adjacent cells to join them.
+ * All randomness comes from MazeRandom, so output depends only on the seed.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include "error.h"
+#include "filelib.h"
+#include "grid.h"
+#include "gridsearch.h"
+#include "maze.h"
+#include "mazegenerator.h"
+#include "mazeio.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+/*
+ * A small seeded generator (splitmix64). The standard library engines are
+ * portable but its distributions are not, so bounded values are derived here.
+ */
+struct MazeRandom {
+    uint64_t state;
+
+    explicit MazeRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /* Returns a value in [0, n), using the high bits to avoid modulo bias. */
+    uint32_t below(uint32_t n) {
+        return uint32_t(((next() >> 32) * n) >> 32);
+    }
+};
+
+/* The working state shared by all the generators. */
+struct MazeCarver {
+    int rows;
+    int cols;
+    int cellRows;
+    int cellCols;
+    vector<unsigned char> open;
+    MazeRandom random;
+
+    MazeCarver(int rows, int cols, unsigned seed)
+        : rows(rows), cols(cols), cellRows((rows + 1) / 2), cellCols((cols + 1) / 2),
+          open(long(rows) * cols, 0), random(seed) {}
+
+    int numCells() const {
+        return cellRows * cellCols;
+    }
+
+    long position(int cell) const {
+        return long(cell / cellCols) * 2 * cols + (cell % cellCols) * 2;
+    }
+
+    void openCell(int cell) {
+        open[position(cell)] = 1;
+    }
+
+    /* Opens both cells and the wall position between them (they must be adjacent). */
+    void join(int a, int b) {
+        long pa = position(a);
+        long pb = position(b);
+        open[pa] = open[pb] = 1;
+        open[(pa + pb) / 2] = 1;
+    }
+
+    /* Stores the in-bounds neighbors of cell in neighbors and returns how many there are. */
+    int neighbors(int cell, int neighbors[4]) const {
+        int count = 0;
+        int r = cell / cellCols;
+        int c = cell % cellCols;
+        if (r > 0) neighbors[count++] = cell - cellCols;
+        if (c > 0) neighbors[count++] = cell - 1;
+        if (c < cellCols - 1) neighbors[count++] = cell + 1;
+        if (r < cellRows - 1) neighbors[count++] = cell + cellCols;
+        return count;
+    }
+};
+
+/*
+ * Iterative depth-first carving: from the top of the stack, step to a random
+ * unvisited neighbor, or pop if there is none.
+ */
+static void carveBacktracker(MazeCarver& carver) {
+    vector<bool> visited(carver.numCells());
+    vector<int> stack;
+    stack.push_back(0);
+    visited[0] = true;
+    carver.openCell(0);
+    while (!stack.empty()) {
+        int cell = stack.back();
+        int candidates[4];
+        int numCandidates = 0;
+        int all[4];
+        int numNeighbors = carver.neighbors(cell, all);
+        for (int i = 0; i < numNeighbors; i++) {
+            if (!visited[all[i]]) candidates[numCandidates++] = all[i];
+        }
+        if (numCandidates == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int next = candidates[carver.random.below(numCandidates)];
+        visited[next] = true;
+        carver.join(cell, next);
+        stack.push_back(next);
+    }
+}
+
+static int findRoot(vector<int>& parent, int cell) {
+    while (parent[cell] != cell) {
+        parent[cell] = parent[parent[cell]];   // path halving
+        cell = parent[cell];
+    }
+    return cell;
+}
+
+/*
+ * Randomized Kruskal: shuffle every wall between adjacent cells and remove
+ * each one that separates two different components. Walls are encoded as
+ * cell * 2 + (0 for the wall to the right, 1 for the wall below).
+ */
+static void carveKruskal(MazeCarver& carver) {
+    int numCells = carver.numCells();
+    vector<uint32_t> walls;
+    walls.reserve(2 * long(numCells));
+    for (int cell = 0; cell < numCells; cell++) {
+        carver.openCell(cell);
+        if (cell % carver.cellCols < carver.cellCols - 1) walls.push_back(uint32_t(cell) * 2);
+        if (cell / carver.cellCols < carver.cellRows - 1) walls.push_back(uint32_t(cell) * 2 + 1);
+    }
+    for (long i = long(walls.size()) - 1; i > 0; i--) {
+        swap(walls[i], walls[carver.random.below(i + 1)]);
+    }
+
+    vector<int> parent(numCells);
+    vector<int> size(numCells, 1);
+    iota(parent.begin(), parent.end(), 0);
+    int numJoined = 0;
+    for (uint32_t wall : walls) {
+        int a = wall / 2;
+        int b = (wall & 1) ? a + carver.cellCols : a + 1;
+        int rootA = findRoot(parent, a);
+        int rootB = findRoot(parent, b);
+        if (rootA == rootB) continue;
+        if (size[rootA] < size[rootB]) swap(rootA, rootB);
+        parent[rootB] = rootA;
+        size[rootA] += size[rootB];
+        carver.join(a, b);
+        if (++numJoined == numCells - 1) break;
+    }
+}
+
+/*
+ * Wilson's algorithm: from each cell not yet in the tree, random-walk until
+ * the tree is hit, remembering only the last exit taken from each cell (which
+ * erases loops), then add the loop-erased walk to the tree.
+ */
+static void carveWilson(MazeCarver& carver) {
+    int numCells = carver.numCells();
+    vector<bool> inTree(numCells);
+    vector<int> nextCell(numCells, -1);
+    int root = carver.random.below(numCells);
+    inTree[root] = true;
+    carver.openCell(root);
+
+    for (int start = 0; start < numCells; start++) {
+        if (inTree[start]) continue;
+        int cell = start;
+        while (!inTree[cell]) {
+            int all[4];
+            int numNeighbors = carver.neighbors(cell, all);
+            nextCell[cell] = all[carver.random.below(numNeighbors)];
+            cell = nextCell[cell];
+        }
+        for (cell = start; !inTree[cell]; cell = nextCell[cell]) {
+            inTree[cell] = true;
+            carver.join(cell, nextCell[cell]);
+        }
+    }
+}
+
+/*
+ * Carves a backtracker maze, then opens about one room per 400 cells. Rooms
+ * span odd-by-odd blocks of maze positions aligned to cells, so they merge
+ * cleanly with the corridors around them.
+ */
+static void carveRooms(MazeCarver& carver) {
+    carveBacktracker(carver);
+    int numRooms = max(1, carver.numCells() / 400);
+    for (int i = 0; i < numRooms; i++) {
+        int roomRows = 1 + carver.random.below(5);   // in cells
+        int roomCols = 1 + carver.random.below(5);
+        if (roomRows > carver.cellRows || roomCols > carver.cellCols) continue;
+        int top = 2 * carver.random.below(carver.cellRows - roomRows + 1);
+        int left = 2 * carver.random.below(carver.cellCols - roomCols + 1);
+        for (int r = top; r <= top + 2 * (roomRows - 1); r++) {
+            for (int c = left; c <= left + 2 * (roomCols - 1); c++) {
+                carver.open[long(r) * carver.cols + c] = 1;
+            }
+        }
+    }
+}
+
+void generateMaze(Grid<bool>& maze, int rows, int cols, MazeStyle style, unsigned seed) {
+    if (rows <= 0 || cols <= 0) {
+        error("generateMaze asked for an empty maze");
+    }
+    MazeCarver carver(rows, cols, seed);
+    switch (style) {
+        case MAZE_BACKTRACKER: carveBacktracker(carver); break;
+        case MAZE_KRUSKAL:     carveKruskal(carver); break;
+        case MAZE_WILSON:      carveWilson(carver); break;
+        case MAZE_ROOMS:       carveRooms(carver); break;
+    }
+
+    // With an even dimension the exit is not on a cell; open a short spur to it
+    // from the nearest cell without joining anything else.
+    carver.open[long(rows) * cols - 1] = 1;
+    if (rows % 2 == 0 && cols % 2 == 0) {
+        carver.open[long(rows - 2) * cols + cols - 1] = 1;
+    }
+
+    maze.resize(rows, cols);
+    auto cell = maze.begin();
+    for (unsigned char open : carver.open) {
+        *cell = open;
+        ++cell;
+    }
+}
+
+void writeGeneratedMaze(string basename, const Grid<bool>& maze) {
+    writeMazeFile(basename + ".maze", maze);
+    Vector<GridLocation> soln;
+    if (!searchBreadthFirst<FourConnected>(GridCells(maze), soln)) {
+        error("writeGeneratedMaze: maze has no solution");
+    }
+    ofstream out(basename + ".soln");
+    if (!out) error("Cannot open file named " + basename + ".soln");
+    out << soln;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Returns the number of open cells minus the number of open adjacent pairs; 1 for a tree. */
+static long countOpenMinusPassages(const Grid<bool>& maze) {
+    long count = 0;
+    for (int r = 0; r < maze.numRows(); r++) {
+        for (int c = 0; c < maze.numCols(); c++) {
+            if (!maze[r][c]) continue;
+            count++;
+            if (r + 1 < maze.numRows() && maze[r + 1][c]) count--;
+            if (c + 1 < maze.numCols() && maze[r][c + 1]) count--;
+        }
+    }
+    return count;
+}
+
+STUDENT_TEST("generateMaze is reproducible from the seed") {
+    for (MazeStyle style : {MAZE_BACKTRACKER, MAZE_KRUSKAL, MAZE_WILSON, MAZE_ROOMS}) {
+        Grid<bool> a, b, c;
+        generateMaze(a, 41, 61, style, 7);
+        generateMaze(b, 41, 61, style, 7);
+        generateMaze(c, 41, 61, style, 8);
+        EXPECT_EQUAL(a, b);
+        EXPECT(a != c);
+    }
+}
+
+STUDENT_TEST("generateMaze makes solvable mazes of any parity, perfect except for rooms") {
+    for (MazeStyle style : {MAZE_BACKTRACKER, MAZE_KRUSKAL, MAZE_WILSON, MAZE_ROOMS}) {
+        for (int rows : {1, 2, 9, 10}) {
+            for (int cols : {1, 2, 15, 16}) {
+                Grid<bool> maze;
+                generateMaze(maze, rows, cols, style, rows * 100 + cols);
+                EXPECT(maze[0][0] && maze[rows - 1][cols - 1]);
+                if (style != MAZE_ROOMS) {
+                    EXPECT_EQUAL(countOpenMinusPassages(maze), 1);
+                }
+                Vector<GridLocation> soln;
+                EXPECT(solveMazeBFS(maze, soln));
+                EXPECT_NO_ERROR(validatePath(maze, soln));
+            }
+        }
+    }
+}
+
+STUDENT_TEST("writeGeneratedMaze writes files readMazeFile and readSolutionFile accept") {
+    Grid<bool> generated, maze;
+    generateMaze(generated, 31, 45, MAZE_KRUSKAL);
+    writeGeneratedMaze("res/_generated", generated);
+    readMazeFile("res/_generated.maze", maze);
+    Vector<GridLocation> soln;
+    readSolutionFile("res/_generated.soln", soln);
+    EXPECT_EQUAL(maze, generated);
+    EXPECT_NO_ERROR(validatePath(maze, soln));
+    deleteFile("res/_generated.maze");
+    deleteFile("res/_generated.soln");
+}
+
+STUDENT_TEST("generateMaze time at 2001x2001 (10001x10001 takes a few seconds)") {
+    Grid<bool> maze;
+    for (MazeStyle style : {MAZE_BACKTRACKER, MAZE_KRUSKAL, MAZE_WILSON, MAZE_ROOMS}) {
+        TIME_OPERATION(2001 * 2001, generateMaze(maze, 2001, 2001, style));
+    }
+}
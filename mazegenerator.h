@@ -0,0 +1,45 @@
+/*
+ * File: mazegenerator.h
+ * ---------------------
+ * Defines procedural maze generation for tests and benchmarks. Mazes are
+ * reproducible: the same size, style and seed always give the same maze,
+ * on every platform.
+ */
+
+#pragma once
+
+#include <string>
+#include "grid.h"
+
+/*
+ * The available generation styles. The first three carve a perfect maze
+ * (exactly one path between any two corridors) with different textures:
+ *   MAZE_BACKTRACKER  depth-first carving, long winding corridors
+ *   MAZE_KRUSKAL      randomized Kruskal, many short dead ends
+ *   MAZE_WILSON       loop-erased random walks, an unbiased uniform spanning tree
+ * MAZE_ROOMS carves a backtracker maze and then opens rectangular rooms in
+ * it, so there are loops and many shortest-path candidates.
+ */
+enum MazeStyle {
+    MAZE_BACKTRACKER,
+    MAZE_KRUSKAL,
+    MAZE_WILSON,
+    MAZE_ROOMS
+};
+
+/*
+ * The generateMaze function fills maze with a new rows x cols maze of the
+ * given style. Corridor cells sit at even (row, col) positions with walls
+ * or passages in between; the entrance (0, 0) and exit (rows-1, cols-1) are
+ * always open and connected, whatever the parity of the dimensions.
+ * Generation is linear in the number of cells (Wilson's is linear on average).
+ */
+void generateMaze(Grid<bool>& maze, int rows, int cols, MazeStyle style, unsigned seed = 106);
+
+/*
+ * The writeGeneratedMaze function writes maze to basename.maze in the
+ * text format read by readMazeFile, solves it with a shortest-path search,
+ * and writes the solution to basename.soln in the format read by
+ * readSolutionFile.
+ */
+void writeGeneratedMaze(std::string basename, const Grid<bool>& maze);
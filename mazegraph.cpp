@@ -0,0 +1,255 @@
+/*
+ * File: mazegraph.cpp
+ * -------------------
+ * Corridor contraction and Dijkstra over the junction graph. Each corridor
+ * is walked once from each end while building (so each appears as an edge
+ * in both directions) and once more for each edge on the final path.
+ */
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "grid.h"
+#include "maze.h"
+#include "mazegenerator.h"
+#include "mazegraph.h"
+#include "mazestats.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+static const int kRowStep[4] = {-1, 0, 0, 1};
+static const int kColStep[4] = {0, -1, 1, 0};
+
+/* Returns the open cell one step from cell in direction dir, or -1. */
+static int step(const MazeGraph& graph, int cell, int dir) {
+    int r = cell / graph.numCols + kRowStep[dir];
+    int c = cell % graph.numCols + kColStep[dir];
+    if (r < 0 || r >= graph.numRows || c < 0 || c >= graph.numCols) return -1;
+    int next = r * graph.numCols + c;
+    return graph.open[next] ? next : -1;
+}
+
+/*
+ * Follows the corridor that leaves node cell start in direction dir until
+ * it reaches a node. Calls visit(cell) for every cell after start, and
+ * returns the cell of the node reached. Cells inside a corridor have
+ * exactly two open neighbors, so there is only ever one way on.
+ */
+template <typename Visit>
+static int walkCorridor(const MazeGraph& graph, int start, int dir, Visit visit) {
+    int prev = start;
+    int cur = step(graph, start, dir);
+    visit(cur);
+    while (graph.nodeOf[cur] < 0) {
+        int next = -1;
+        for (int d = 0; d < 4 && next < 0; d++) {
+            int neighbor = step(graph, cur, d);
+            if (neighbor >= 0 && neighbor != prev) next = neighbor;
+        }
+        prev = cur;
+        cur = next;
+        visit(cur);
+    }
+    return cur;
+}
+
+void buildMazeGraph(const Grid<bool>& maze, MazeGraph& graph) {
+    graph = MazeGraph();
+    graph.numRows = maze.numRows();
+    graph.numCols = maze.numCols();
+    long numCells = long(graph.numRows) * graph.numCols;
+    graph.open.reserve(numCells);
+    for (bool isOpen : maze) {
+        graph.open.push_back(isOpen);
+    }
+    if (numCells == 0) return;
+
+    graph.nodeOf.assign(numCells, -1);
+    for (int cell = 0; cell < numCells; cell++) {
+        if (!graph.open[cell]) continue;
+        int degree = 0;
+        for (int dir = 0; dir < 4; dir++) {
+            if (step(graph, cell, dir) >= 0) degree++;
+        }
+        if (degree != 2 || cell == 0 || cell == numCells - 1) {
+            graph.nodeOf[cell] = graph.nodeCell.size();
+            graph.nodeCell.push_back(cell);
+        }
+    }
+    graph.entry = graph.nodeOf[0];
+    graph.exit = graph.nodeOf[numCells - 1];
+
+    graph.edgeStart.reserve(graph.numNodes() + 1);
+    for (int node = 0; node < graph.numNodes(); node++) {
+        graph.edgeStart.push_back(graph.edges.size());
+        int cell = graph.nodeCell[node];
+        for (int dir = 0; dir < 4; dir++) {
+            if (step(graph, cell, dir) < 0) continue;
+            int length = 0;
+            int end = walkCorridor(graph, cell, dir, [&](int) { length++; });
+            if (end != cell) {   // a corridor looping back to its own node is never on a shortest path
+                graph.edges.push_back({graph.nodeOf[end], length, dir});
+            }
+        }
+    }
+    graph.edgeStart.push_back(graph.edges.size());
+}
+
+bool solveMazeGraph(const MazeGraph& graph, Vector<GridLocation>& soln, SolveStats* stats) {
+    soln.clear();
+    bool tracking = statsEnabled(stats);
+    PhaseTimer timer(tracking);
+    long expanded = 0;
+    size_t peakQueue = 0;
+    if (tracking) {
+        stats->nodesExpanded = stats->peakFrontier = stats->peakBytes = 0;
+        stats->solveMs = stats->reconstructMs = 0;
+        stats->pathLength = 0;
+    }
+    if (graph.entry < 0 || graph.exit < 0) return false;
+
+    // dist and the edge used to reach each node, indexed by node
+    vector<int> dist(graph.numNodes(), -1);
+    vector<int> viaEdge(graph.numNodes(), -1);
+    vector<int> fromNode(graph.numNodes(), -1);
+    typedef pair<int, int> Entry;   // (distance, node)
+    priority_queue<Entry, vector<Entry>, greater<Entry>> queue;
+    dist[graph.entry] = 0;
+    queue.push({0, graph.entry});
+    while (!queue.empty()) {
+        if (tracking) peakQueue = max(peakQueue, queue.size());
+        Entry top = queue.top();
+        queue.pop();
+        int node = top.second;
+        if (top.first != dist[node]) continue;   // a shorter route was found after this was queued
+        expanded++;
+        if (node == graph.exit) break;
+        for (int e = graph.edgeStart[node]; e < graph.edgeStart[node + 1]; e++) {
+            const MazeEdge& edge = graph.edges[e];
+            int d = top.first + edge.length;
+            if (dist[edge.to] < 0 || d < dist[edge.to]) {
+                dist[edge.to] = d;
+                viaEdge[edge.to] = e;
+                fromNode[edge.to] = node;
+                queue.push({d, edge.to});
+            }
+        }
+    }
+    if (tracking) {
+        stats->nodesExpanded = expanded;
+        stats->peakFrontier = peakQueue;
+        stats->peakBytes = 3 * sizeof(int) * graph.numNodes() + peakQueue * sizeof(Entry);
+        stats->solveMs = timer.lapMs();
+    }
+    if (dist[graph.exit] < 0) return false;
+
+    vector<int> route;   // edges from the exit back to the entry
+    for (int node = graph.exit; node != graph.entry; node = fromNode[node]) {
+        route.push_back(viaEdge[node]);
+    }
+    int cols = graph.numCols;
+    int cell = graph.nodeCell[graph.entry];
+    soln.add({cell / cols, cell % cols});
+    for (int i = int(route.size()) - 1; i >= 0; i--) {
+        const MazeEdge& edge = graph.edges[route[i]];
+        cell = walkCorridor(graph, cell, edge.dir, [&](int c) { soln.add({c / cols, c % cols}); });
+    }
+    if (tracking) {
+        stats->peakBytes += route.size() * sizeof(int) + soln.size() * sizeof(GridLocation);
+        stats->reconstructMs = timer.lapMs();
+        stats->pathLength = soln.size();
+    }
+    return true;
+}
+
+/* Returns the bytes held by the arrays of graph. */
+static long graphBytes(const MazeGraph& graph) {
+    return graph.open.size() + sizeof(int) * (graph.nodeCell.size() + graph.nodeOf.size() + graph.edgeStart.size())
+           + sizeof(MazeEdge) * graph.edges.size();
+}
+
+bool solveMazeJunctions(const Grid<bool>& maze, Vector<GridLocation>& soln, SolveStats* stats) {
+    PhaseTimer timer(statsEnabled(stats));
+    MazeGraph graph;
+    buildMazeGraph(maze, graph);
+    double buildMs = timer.lapMs();
+    bool solved = solveMazeGraph(graph, soln, stats);
+    if (statsEnabled(stats)) {
+        stats->solveMs += buildMs;   // building the graph is part of the search
+        stats->peakBytes += graphBytes(graph);
+    }
+    return solved;
+}
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("buildMazeGraph contracts corridors into weighted edges") {
+    // An L-shaped corridor from the entry to a junction, then two ways to the exit.
+    Grid<bool> maze = {{true, true, true, false},
+                       {false, false, true, true},
+                       {false, false, true, true},
+                       {false, false, false, true}};
+    MazeGraph graph;
+    buildMazeGraph(maze, graph);
+    EXPECT_EQUAL(graph.nodeCell[graph.entry], 0);
+    EXPECT_EQUAL(graph.nodeCell[graph.exit], 15);
+    EXPECT(graph.numNodes() < 9);
+    for (int e = graph.edgeStart[graph.entry]; e < graph.edgeStart[graph.entry + 1]; e++) {
+        EXPECT_EQUAL(graph.nodeCell[graph.edges[e].to], 6);   // the first junction
+        EXPECT_EQUAL(graph.edges[e].length, 3);
+    }
+
+    Vector<GridLocation> soln;
+    EXPECT(solveMazeGraph(graph, soln));
+    EXPECT_EQUAL(soln.size(), 7);
+    EXPECT_NO_ERROR(validatePath(maze, soln));
+}
+
+STUDENT_TEST("solveMazeJunctions matches solveMazeBFS path lengths on res/ and generated mazes") {
+    for (string name : {"res/5x7.maze", "res/19x35.maze", "res/21x23.maze", "res/33x41.maze",
+                        "res/6x6.maze", "res/24x32.maze"}) {
+        Grid<bool> maze;
+        readMazeFile(name, maze);
+        Vector<GridLocation> expected, soln;
+        EXPECT_EQUAL(solveMazeJunctions(maze, soln), solveMazeBFS(maze, expected));
+        EXPECT_EQUAL(soln.size(), expected.size());
+        if (!soln.isEmpty()) EXPECT_NO_ERROR(validatePath(maze, soln));
+    }
+    for (MazeStyle style : {MAZE_BACKTRACKER, MAZE_KRUSKAL, MAZE_ROOMS}) {
+        Grid<bool> maze;
+        generateMaze(maze, 40, 61, style, 3);
+        Vector<GridLocation> expected, soln;
+        EXPECT(solveMazeJunctions(maze, soln));
+        EXPECT(solveMazeBFS(maze, expected));
+        EXPECT_EQUAL(soln.size(), expected.size());
+        EXPECT_NO_ERROR(validatePath(maze, soln));
+    }
+
+    Grid<bool> single(1, 1, true);
+    Vector<GridLocation> soln;
+    EXPECT(solveMazeJunctions(single, soln));
+    EXPECT_EQUAL(soln, {{0, 0}});
+}
+
+STUDENT_TEST("Junction graph build and solve time vs solveMazeBFS") {
+    for (MazeStyle style : {MAZE_BACKTRACKER, MAZE_KRUSKAL, MAZE_ROOMS}) {
+        Grid<bool> maze;
+        generateMaze(maze, 2001, 2001, style);
+        Vector<GridLocation> soln, expected;
+        TIME_OPERATION(maze.numRows() * maze.numCols(), solveMazeBFS(maze, expected));
+        TIME_OPERATION(maze.numRows() * maze.numCols(), solveMazeJunctions(maze, soln));
+        EXPECT_EQUAL(soln.size(), expected.size());
+
+        // Building is most of the cost, so the graph only pays off when it is solved repeatedly
+        MazeGraph graph;
+        TIME_OPERATION(maze.numRows() * maze.numCols(), buildMazeGraph(maze, graph));
+        TIME_OPERATION(graph.numNodes(), solveMazeGraph(graph, soln));
+        EXPECT_EQUAL(soln.size(), expected.size());
+        long numOpen = 0;
+        for (unsigned char open : graph.open) numOpen += open;
+        EXPECT(graph.numNodes() < numOpen);
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * File: mazegraph.h
+ * -----------------
+ * Defines a compressed view of a maze in which every corridor is a single
+ * weighted edge, and a shortest-path solver that runs on it.
+ */
+
+#pragma once
+
+#include <vector>
+#include "grid.h"
+#include "vector.h"
+
+struct SolveStats;
+
+/*
+ * An edge leaves its node in direction dir (0 north, 1 west, 2 east,
+ * 3 south) and follows a corridor of length moves to node to.
+ */
+struct MazeEdge {
+    int to;
+    int length;
+    int dir;
+};
+
+/*
+ * The MazeGraph struct holds the junction graph of a maze. Its nodes are
+ * the open locations that do not have exactly two open neighbors
+ * (junctions and dead ends) plus the entry and exit. Every other open
+ * location lies inside a corridor between two nodes. The corridor is
+ * stored as one edge, and its cells are only walked again when a path
+ * through it is expanded. Edges are in compressed adjacency form: the
+ * edges of node n are edges[edgeStart[n]] up to edges[edgeStart[n + 1]].
+ */
+struct MazeGraph {
+    int numRows = 0;
+    int numCols = 0;
+    std::vector<unsigned char> open;   // flattened maze, cell = row * numCols + col
+    std::vector<int> nodeCell;         // the cell of each node
+    std::vector<int> nodeOf;           // the node at each cell, or -1
+    std::vector<int> edgeStart;
+    std::vector<MazeEdge> edges;
+    int entry = -1;                    // node numbers, -1 if the location is a wall
+    int exit = -1;
+
+    int numNodes() const {
+        return nodeCell.size();
+    }
+};
+
+/*
+ * The buildMazeGraph function fills graph with the junction graph of maze,
+ * in time linear in the number of locations.
+ */
+void buildMazeGraph(const Grid<bool>& maze, MazeGraph& graph);
+
+/*
+ * The solveMazeGraph function runs Dijkstra's algorithm from the entry to
+ * the exit of graph, then expands the chosen edges back into locations.
+ * It stores the resulting shortest path (one location per move, as
+ * validatePath expects) in soln and returns true, or returns false if
+ * there is no path. stats, if not null, is filled in (see mazestats.h),
+ * counting graph nodes rather than locations.
+ */
+bool solveMazeGraph(const MazeGraph& graph, Vector<GridLocation>& soln, SolveStats* stats = nullptr);
+
+/*
+ * The solveMazeJunctions function builds the junction graph of maze and
+ * solves it with solveMazeGraph. Its paths have the same length as the
+ * ones from solveMazeBFS. Building the graph counts towards the solve
+ * time and its arrays towards the peak bytes in stats.
+ *
+ * Building the graph walks every location, so for a single query this is
+ * slower than solveMazeBFS. The graph only pays off when it is built once
+ * and solveMazeGraph is called on it many times; use solveMazeBFS for
+ * one-off solves.
+ */
+bool solveMazeJunctions(const Grid<bool>& maze, Vector<GridLocation>& soln, SolveStats* stats = nullptr);
@@ -6,12 +6,15 @@
  * welcome to read over this code, but you will not need to edit it.
  */
 #include "gbutton.h"
+#include "gcolor.h"
 #include "glabel.h"
 #include "gwindow.h"
-#include <iomanip>  // for setw, setfill
+#include <algorithm>
+#include <chrono>
 #include "error.h"
 #include "gthread.h"
 #include "map.h"
+#include "mazeexport.h"
 #include "mazegraphics.h"
 using namespace std;
 
@@ -27,8 +30,45 @@ struct cellT {
     GRect *square;
     GOval *dot;
     bool marked;
+    unsigned stamp;     // equals gStamp while highlightPath is diffing if cell is on the new path
 };
 static Grid<cellT> gCells;
+static Grid<bool> gMaze;
+
+/*
+ * Mazes with more cells than this are drawn in raster mode: instead of a GRect
+ * and GOval per cell, the whole maze is rendered into one pixel buffer that is
+ * handed to the window in a single call. In raster mode gCells keeps only the
+ * marked flags (square and dot are null). If the maze is larger than the window
+ * in either direction, each pixel covers a cellsPerPixel x cellsPerPixel block
+ * of cells and takes the path color if any cell in the block is marked, else the
+ * majority color of the block.
+ */
+static const int kMaxObjectCells = 40000;
+static const int kButtonHeight = 30;
+static const int kMaxSinglePixelUpdates = 256;
+
+static bool gRaster;
+static int gCellSize;          // pixels per cell side (raster or objects)
+static int gCellsPerPixel;     // cells per pixel side when downsampling, else 1
+static Grid<int> gPixels;      // raster mode: canvas pixels, row = y
+static int gWallRGB, gCorridorRGB, gPathRGB;
+
+/*
+ * highlightPath redraws only the cells whose marking or color changed since
+ * the previously drawn path, and repaints only the pixel rectangle bounding
+ * them (the damage). With a frame rate set, repaints closer together than one
+ * frame are skipped and their damage accumulates into the next one.
+ */
+struct damageT {
+    int left, top, right, bottom;   // pixel bounds, empty when right <= left
+};
+static Vector<GridLocation> gDrawnPath;
+static string gDrawnColor;
+static unsigned gStamp;
+static damageT gDamage;
+static int gFrameRate;
+static chrono::steady_clock::time_point gLastRepaint;
 
 static void unpause(bool noFuturePause = false) {
     gLabel->setColor(gLabel->getBackground());
@@ -78,13 +118,35 @@ static void changeDimensions(int numRows, int numCols) {
     gWindow->clear();
     gCells.clear();
     gCells.resize(numRows, numCols);
+    gRaster = long(numRows) * numCols > kMaxObjectCells;
+    gCellsPerPixel = 1;
     int cellSize = kDefaultCellSize;
     if (kDefaultCellSize*min(numRows, numCols) < kMinWindowSize)
         cellSize = min(kMinWindowSize/min(numRows, numCols), kMaxWindowSize/max(numRows, numCols));
+    if (gRaster) {
+        cellSize = min(kDefaultCellSize, kMaxWindowSize/max(numRows, numCols));
+        if (cellSize < 1) {
+            cellSize = 1;
+            gCellsPerPixel = (max(numRows, numCols) + kMaxWindowSize - 1) / kMaxWindowSize;
+        }
+    }
+    gCellSize = cellSize;
+    int width = (numCols + gCellsPerPixel - 1) / gCellsPerPixel * cellSize;
+    int height = (numRows + gCellsPerPixel - 1) / gCellsPerPixel * cellSize;
+    gWindow->setCanvasSize(width, height + kButtonHeight); // room for button in south
+
+    if (gRaster) {
+        gPixels.resize(height + kButtonHeight, width);
+        for (auto& c : gCells) {
+            c.square = nullptr;
+            c.dot = nullptr;
+            c.marked = false;
+        }
+        return;
+    }
+
     int dotSize = int(cellSize * .6);
     int margin = (cellSize - dotSize)/2;
-    gWindow->setCanvasSize(numCols*cellSize, numRows*cellSize + 30); // 30 for button in south
-
     for (const auto& loc : gCells.locations()) {
         gCells[loc].square = new GRect(loc.col * cellSize, loc.row * cellSize, cellSize, cellSize);
         gCells[loc].square->setVisible(false);
@@ -96,8 +158,66 @@ static void changeDimensions(int numRows, int numCols) {
     }
 }
 
+/*
+ * Renders the block of cells that maps to raster pixel block (px, py) into gPixels.
+ * Without downsampling that block is the single cell at row py, column px, drawn
+ * as a cellSize square with a centered dot if it is marked.
+ */
+static void rasterPaintBlock(int px, int py) {
+    int firstRow = py * gCellsPerPixel, lastRow = min(firstRow + gCellsPerPixel, gMaze.numRows());
+    int firstCol = px * gCellsPerPixel, lastCol = min(firstCol + gCellsPerPixel, gMaze.numCols());
+    int numWalls = 0, numMarked = 0;
+    for (int r = firstRow; r < lastRow; r++) {
+        for (int c = firstCol; c < lastCol; c++) {
+            if (!gMaze[r][c]) numWalls++;
+            if (gCells[r][c].marked) numMarked++;
+        }
+    }
+    int numCells = (lastRow - firstRow) * (lastCol - firstCol);
+    int background = (2 * numWalls > numCells) ? gWallRGB : gCorridorRGB;
+
+    int dotSize = max(1, int(gCellSize * .6));
+    int margin = (gCellSize - dotSize)/2;
+    for (int y = 0; y < gCellSize; y++) {
+        for (int x = 0; x < gCellSize; x++) {
+            bool inDot = y >= margin && y < margin + dotSize && x >= margin && x < margin + dotSize;
+            gPixels[py * gCellSize + y][px * gCellSize + x] = (numMarked > 0 && inDot) ? gPathRGB : background;
+        }
+    }
+}
+
+/* Renders every block of the maze into gPixels and hands the buffer to the window. */
+static void rasterPaintAll() {
+    gPixels.fill(GColor::convertColorToRGB("White"));
+    int blockRows = (gMaze.numRows() + gCellsPerPixel - 1) / gCellsPerPixel;
+    int blockCols = (gMaze.numCols() + gCellsPerPixel - 1) / gCellsPerPixel;
+    for (int py = 0; py < blockRows; py++) {
+        for (int px = 0; px < blockCols; px++) {
+            rasterPaintBlock(px, py);
+        }
+    }
+    gWindow->setPixels(gPixels);
+}
+
 void drawMaze(const Grid<bool>& g) {
     if (!gInitialized) return;
+    gMaze = g;
+    gDrawnPath.clear();
+    gDrawnColor.clear();
+    gDamage = {0, 0, 0, 0};
+    for (auto& c : gCells) {
+        c.marked = false;
+        c.stamp = 0;
+    }
+    gStamp = 0;
+    if (gRaster) {
+        gWallRGB = GColor::convertColorToRGB(gColors[false]);
+        gCorridorRGB = GColor::convertColorToRGB(gColors[true]);
+        rasterPaintAll();
+        gWindow->setVisible(true);
+        GThread::runOnQtGuiThread([] { gWindow->repaint(); });
+        return;
+    }
     for (const auto& loc : gCells.locations()) {
         int val = g[loc];
         gCells[loc].dot->setVisible(false);
@@ -122,35 +242,131 @@ void initGraphicsForMaze(const Grid<bool>& g, bool pauseOnRedraw) {
     drawMaze(g);
 }
 
+static void addDamage(GridLocation loc) {
+    int left = loc.col / gCellsPerPixel * gCellSize, top = loc.row / gCellsPerPixel * gCellSize;
+    int right = left + gCellSize, bottom = top + gCellSize;
+    if (gDamage.right <= gDamage.left) {
+        gDamage = {left, top, right, bottom};
+    } else {
+        gDamage = {min(gDamage.left, left), min(gDamage.top, top),
+                   max(gDamage.right, right), max(gDamage.bottom, bottom)};
+    }
+}
+
+/* Updates the drawing of one cell to match its marked flag and the given color. */
+static void redrawCell(GridLocation loc, const string& color) {
+    cellT& cell = gCells[loc];
+    if (gRaster) {
+        rasterPaintBlock(loc.col / gCellsPerPixel, loc.row / gCellsPerPixel);
+    } else if (cell.marked) {
+        cell.dot->setVisible(true);
+        cell.dot->setColor(color);
+        cell.dot->setFillColor(color);
+    } else {
+        cell.dot->setVisible(false);
+    }
+    addDamage(loc);
+}
+
+/* Pushes changed raster pixels to the window and repaints the damaged rectangle. */
+static void repaintDamage() {
+    damageT d = gDamage;
+    gDamage = {0, 0, 0, 0};
+    gLastRepaint = chrono::steady_clock::now();
+    if (d.right <= d.left) return;
+    if (gRaster) {
+        // Each setPixel call may be a round trip to the GUI thread, so only
+        // a few pixels are sent one at a time; anything more goes in one call
+        long area = long(d.right - d.left) * (d.bottom - d.top);
+        if (area > kMaxSinglePixelUpdates) {
+            gWindow->setPixels(gPixels);
+        } else {
+            for (int y = d.top; y < d.bottom; y++) {
+                for (int x = d.left; x < d.right; x++) {
+                    gWindow->setPixel(x, y, gPixels[y][x]);
+                }
+            }
+        }
+    }
+    GThread::runOnQtGuiThread([d] { gWindow->repaintRegion(d.left, d.top, d.right - d.left, d.bottom - d.top); });
+}
+
+/* Repaints if a frame is due under the frame rate limit, then pauses for a click if configured. */
+static void finishHighlight() {
+    bool frameDue = gFrameRate <= 0
+        || chrono::steady_clock::now() - gLastRepaint >= chrono::microseconds(1000000 / gFrameRate);
+    if (frameDue || gPauseForClick) repaintDamage();
+    if (gPauseForClick) pauseForClick();
+}
+
+void setHighlightFrameRate(int framesPerSecond) {
+    gFrameRate = max(0, framesPerSecond);
+}
+
+void flushHighlights() {
+    if (!gInitialized) return;
+    repaintDamage();
+}
+
 void highlightPath(const Vector<GridLocation>& path, string color) {
     if (!gInitialized) return;
 
-    for (auto& c : gCells) c.marked = false;
     for (GridLocation loc: path) {
         if (!gCells.inBounds(loc)) error("highlightPath asked to highlight path location: " + loc.toString() + " that is out of bounds for drawn grid.");
-        gCells[loc].marked = true;
     }
-    for (auto& c : gCells) {
-        if (c.marked) {
-            c.dot->setVisible(true);
-            c.dot->setColor(color);
-            c.dot->setFillColor(color);
-        } else {
-            c.dot->setVisible(false);
+    bool recolor = (color != gDrawnColor);
+    if (gRaster) gPathRGB = GColor::convertColorToRGB(color);
+
+    // Stamp the new path, unmark old cells without the stamp, then mark
+    // (or recolor) new cells. Work is proportional to the two path lengths.
+    if (++gStamp == 0) {
+        for (auto& c : gCells) c.stamp = 0;
+        gStamp = 1;
+    }
+    for (GridLocation loc: path) gCells[loc].stamp = gStamp;
+    for (GridLocation loc: gDrawnPath) {
+        if (gCells[loc].stamp != gStamp && gCells[loc].marked) {
+            gCells[loc].marked = false;
+            redrawCell(loc, color);
         }
     }
-    GThread::runOnQtGuiThread([] {  gWindow->repaint(); });
-    if (gPauseForClick) pauseForClick();
+    for (GridLocation loc: path) {
+        if (!gCells[loc].marked || recolor) {
+            gCells[loc].marked = true;
+            redrawCell(loc, color);
+        }
+    }
+    gDrawnPath = path;
+    gDrawnColor = color;
+    finishHighlight();
+}
 
+void extendHighlight(const Vector<GridLocation>& more, string color) {
+    if (!gInitialized) return;
+
+    if (color != gDrawnColor && !gDrawnPath.isEmpty()) {
+        Vector<GridLocation> path = gDrawnPath;
+        for (GridLocation loc: more) path.add(loc);
+        highlightPath(path, color);
+        return;
+    }
+    for (GridLocation loc: more) {
+        if (!gCells.inBounds(loc)) error("extendHighlight asked to highlight path location: " + loc.toString() + " that is out of bounds for drawn grid.");
+    }
+    if (gRaster) gPathRGB = GColor::convertColorToRGB(color);
+    for (GridLocation loc: more) {
+        if (!gCells[loc].marked) {
+            gCells[loc].marked = true;
+            redrawCell(loc, color);
+            gDrawnPath.add(loc);
+        }
+    }
+    gDrawnColor = color;
+    finishHighlight();
 }
 
 void printMaze() {
     if (!gInitialized) return;
 
-    for (const auto& loc : gCells.locations()) {
-        char ch = (gCells[loc].square->isVisible()) ? '@' : ' ';
-        if (gCells[loc].marked) ch = '+';
-        cout << setw(3) << setfill(' ') << ch;
-        if (loc.col == gCells.numCols()-1) cout << endl;
-    }
+    writeMazeText(cout, gMaze, gDrawnPath);
 }
@@ -21,6 +21,12 @@
  * animation to pause on each call to highlightPath and require a click from
  * the user before proceeding. If not specified, pauseForClick defaults to false,
  * indicating the animation should proceed without pausing.
+ *
+ * Small mazes are drawn with one shape per location. Large mazes (more than
+ * 40,000 locations) are instead rendered into a single pixel buffer, scaled
+ * down so that the window never exceeds 800 pixels on a side, which keeps
+ * setup and redraw time proportional to the window size rather than
+ * the number of graphics objects.
  */
 void initGraphicsForMaze(const Grid<bool>& maze, bool pauseForClick = false);
 
@@ -39,6 +45,34 @@ void initGraphicsForMaze(const Grid<bool>& maze, bool pauseForClick = false);
  */
 void highlightPath(const Vector<GridLocation>& p, std::string color);
 
+/*
+ * Each call to highlightPath only redraws the locations that were added to
+ * or dropped from the previously highlighted path (or all of them, if the
+ * color changed), so animating a search costs time proportional to the
+ * paths, not the maze. The setHighlightFrameRate function additionally
+ * limits how often the window is repainted: with a rate of N, calls that
+ * come less than 1/N second after the last repaint update the drawing but
+ * defer the repaint. A rate of 0 (the default) repaints on every call.
+ * Calls that pause for a click always repaint.
+ */
+void setHighlightFrameRate(int framesPerSecond);
+
+/*
+ * The extendHighlight function marks the locations in more on top of the
+ * currently highlighted path, leaving the locations already marked as they
+ * are, so its cost is proportional to more alone. The combined locations
+ * become the highlighted path that the next highlightPath call diffs
+ * against. If color differs from the current highlight, everything is
+ * redrawn in the new color, as highlightPath would do.
+ */
+void extendHighlight(const Vector<GridLocation>& more, std::string color);
+
+/*
+ * The flushHighlights function repaints any changes deferred by the
+ * frame rate limit, such as the final path of a solve.
+ */
+void flushHighlights();
+
 
 /**
  * The printMaze function can optionally be used to output a text version
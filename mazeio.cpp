@@ -0,0 +1,249 @@
+/*
+ * File: mazeio.cpp
+ * ----------------
+ * Fast maze loading and saving. Files are memory-mapped (or read in one
+ * call) and parsed in a single pass straight into the grid, with the
+ * per-character validity check folded into a flag that is only examined
+ * once per row.
+ */
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "error.h"
+#include "filecontents.h"
+#include "filelib.h"
+#include "grid.h"
+#include "maze.h"
+#include "mazeio.h"
+#include "mazeparallel.h"
+#include "strlib.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+static const char kBinaryMagic[4] = {'M', 'A', 'Z', 'B'};
+static const uint32_t kBinaryVersion = 1;
+static const size_t kBinaryHeaderSize = 16;
+
+static void checkEntranceAndExit(const Grid<bool>& maze) {
+    if (!maze[0][0] || !maze[maze.numRows() - 1][maze.numCols() - 1]) {
+        error("Maze entrance and exit must be both be open corridors");
+    }
+}
+
+/*
+ * Rows are fixed-width, so the row count follows from the file length and
+ * the length of the first line; each row's terminator is then checked as
+ * the row is parsed rather than in a separate line-splitting pass.
+ */
+void parseMazeText(const char* text, size_t length, Grid<bool>& maze) {
+    const char* newline = static_cast<const char*>(memchr(text, '\n', length));
+    size_t numCols = newline ? newline - text : length;
+    size_t eolLength = 1;
+    if (numCols > 0 && text[numCols - 1] == '\r') {
+        numCols--;
+        eolLength = 2;
+    }
+    if (numCols == 0) {
+        error("Maze file is empty");
+    }
+
+    // one trailing line ending is optional
+    size_t body = length;
+    if (newline && body >= eolLength && text[body - 1] == '\n') {
+        body -= eolLength;
+    }
+    size_t stride = numCols + eolLength;
+    if ((body + eolLength) % stride != 0) {
+        error("Maze row has inconsistent number of columns");
+    }
+    int numRows = (body + eolLength) / stride;
+    maze.resize(numRows, numCols);
+
+    auto cell = maze.begin();
+    for (int r = 0; r < numRows; r++) {
+        const char* row = text + r * stride;
+        unsigned bad = 0;
+        for (size_t c = 0; c < numCols; c++) {
+            char ch = row[c];
+            bad |= (ch != '-') & (ch != '@');
+            *cell = (ch == '-');
+            ++cell;
+        }
+        bool lastRow = (r == numRows - 1);
+        if (!lastRow && (row[numCols + eolLength - 1] != '\n' || (eolLength == 2 && row[numCols] != '\r'))) {
+            error("Maze row has inconsistent number of columns");
+        }
+        if (bad) {
+            for (size_t c = 0; c < numCols; c++) {
+                if (row[c] == '\n' || row[c] == '\r') {
+                    error("Maze row has inconsistent number of columns");
+                } else if (row[c] != '-' && row[c] != '@') {
+                    error("Maze location has invalid character: '" + charToString(row[c]) + "'");
+                }
+            }
+        }
+    }
+    checkEntranceAndExit(maze);
+}
+
+bool isBinaryMaze(const char* data, size_t length) {
+    return length >= sizeof(kBinaryMagic) && memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) == 0;
+}
+
+static uint32_t readUint32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+}
+
+static void writeUint32(ostream& out, uint32_t value) {
+    char b[4] = {char(value), char(value >> 8), char(value >> 16), char(value >> 24)};
+    out.write(b, sizeof(b));
+}
+
+void parseMazeBinary(const char* data, size_t length, Grid<bool>& maze) {
+    if (length < kBinaryHeaderSize || !isBinaryMaze(data, length)) {
+        error("Binary maze file has an invalid header");
+    }
+    if (readUint32(data + 4) != kBinaryVersion) {
+        error("Binary maze file has unsupported version " + integerToString(readUint32(data + 4)));
+    }
+    uint32_t numRows = readUint32(data + 8);
+    uint32_t numCols = readUint32(data + 12);
+    uint64_t numCells = uint64_t(numRows) * numCols;
+    if (numCells == 0 || numRows > INT32_MAX || numCols > INT32_MAX) {
+        error("Binary maze file has invalid dimensions");
+    }
+    if (length != kBinaryHeaderSize + (numCells + 7) / 8) {
+        error("Binary maze file is truncated or has trailing data");
+    }
+
+    maze.resize(numRows, numCols);
+    const unsigned char* bits = reinterpret_cast<const unsigned char*>(data + kBinaryHeaderSize);
+    auto cell = maze.begin();
+    for (uint64_t i = 0; i < numCells; i++) {
+        *cell = (bits[i >> 3] >> (i & 7)) & 1;
+        ++cell;
+    }
+    checkEntranceAndExit(maze);
+}
+
+void writeMazeFile(string filename, const Grid<bool>& maze) {
+    ofstream out(filename, ios::binary);
+    if (!out) error("Cannot open file named " + filename);
+    string row(maze.numCols() + 1, '\n');
+    auto cell = maze.begin();
+    for (int r = 0; r < maze.numRows(); r++) {
+        for (int c = 0; c < maze.numCols(); c++) {
+            row[c] = *cell ? '-' : '@';
+            ++cell;
+        }
+        out.write(row.data(), row.size());
+    }
+    if (!out) error("Error writing maze file " + filename);
+}
+
+void writeMazeBinary(string filename, const Grid<bool>& maze) {
+    ofstream out(filename, ios::binary);
+    if (!out) error("Cannot open file named " + filename);
+    out.write(kBinaryMagic, sizeof(kBinaryMagic));
+    writeUint32(out, kBinaryVersion);
+    writeUint32(out, maze.numRows());
+    writeUint32(out, maze.numCols());
+
+    // pack through a fixed-size buffer so memory stays flat for any maze size
+    static const size_t kChunkBytes = 1 << 16;
+    string chunk;
+    chunk.reserve(kChunkBytes);
+    unsigned char byte = 0;
+    int bit = 0;
+    for (bool open : maze) {
+        byte |= (open ? 1 : 0) << bit;
+        if (++bit == 8) {
+            chunk.push_back(char(byte));
+            byte = 0;
+            bit = 0;
+            if (chunk.size() == kChunkBytes) {
+                out.write(chunk.data(), chunk.size());
+                chunk.clear();
+            }
+        }
+    }
+    if (bit > 0) chunk.push_back(char(byte));
+    out.write(chunk.data(), chunk.size());
+    if (!out) error("Error writing maze file " + filename);
+}
+
+void convertMazeToBinary(string textFile, string binaryFile) {
+    Grid<bool> maze;
+    readMazeFile(textFile, maze);
+    writeMazeBinary(binaryFile, maze);
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+static void expectParseError(const string& text) {
+    Grid<bool> maze;
+    EXPECT_ERROR(parseMazeText(text.data(), text.size(), maze));
+}
+
+STUDENT_TEST("parseMazeText accepts either line ending and an optional final newline") {
+    Grid<bool> expected = {{true, false, true},
+                           {true, true, true}};
+    for (string text : {"-@-\n---", "-@-\n---\n", "-@-\r\n---", "-@-\r\n---\r\n"}) {
+        Grid<bool> maze;
+        parseMazeText(text.data(), text.size(), maze);
+        EXPECT_EQUAL(maze, expected);
+    }
+}
+
+STUDENT_TEST("parseMazeText rejects malformed mazes") {
+    expectParseError("");
+    expectParseError("\n---");
+    expectParseError("---\n--\n---");
+    expectParseError("---\n----\n---");
+    expectParseError("---\n---\n\n");
+    expectParseError("-x-\n---");
+    expectParseError("@--\n---");
+    expectParseError("---\n--@");
+}
+
+STUDENT_TEST("text and binary maze files round-trip every maze in res/") {
+    for (string name : listDirectory("res")) {
+        if (!endsWith(name, ".maze")) continue;
+        Grid<bool> original, fromText, fromBinary;
+        readMazeFile("res/" + name, original);
+
+        writeMazeFile("res/_roundtrip.maze", original);
+        readMazeFile("res/_roundtrip.maze", fromText);
+        EXPECT_EQUAL(fromText, original);
+
+        convertMazeToBinary("res/" + name, "res/_roundtrip.mazebin");
+        readMazeFile("res/_roundtrip.mazebin", fromBinary);
+        EXPECT_EQUAL(fromBinary, original);
+    }
+    deleteFile("res/_roundtrip.maze");
+    deleteFile("res/_roundtrip.mazebin");
+
+    string truncated("MAZB\1\0\0\0\2\0\0\0\2\0\0\0", 16);
+    Grid<bool> maze;
+    EXPECT_ERROR(parseMazeBinary(truncated.data(), truncated.size(), maze));
+}
+
+STUDENT_TEST("readMazeFile load time on a 3000x3000 maze, text vs binary") {
+    Grid<bool> original, maze;
+    makeSyntheticMaze(original, 3000, 3000);
+    writeMazeFile("res/_large.maze", original);
+    writeMazeBinary("res/_large.mazebin", original);
+
+    TIME_OPERATION(original.numRows() * original.numCols(), readMazeFile("res/_large.maze", maze));
+    EXPECT_EQUAL(maze, original);
+    TIME_OPERATION(original.numRows() * original.numCols(), readMazeFile("res/_large.mazebin", maze));
+    EXPECT_EQUAL(maze, original);
+
+    deleteFile("res/_large.maze");
+    deleteFile("res/_large.mazebin");
+}
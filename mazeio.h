@@ -0,0 +1,61 @@
+/*
+ * File: mazeio.h
+ * --------------
+ * Defines fast loading and saving of maze files, in both the @/- text
+ * format and a compact bit-packed binary format.
+ *
+ * Binary maze layout (all integers little-endian):
+ *     bytes 0-3    magic "MAZB"
+ *     bytes 4-7    format version (1)
+ *     bytes 8-11   number of rows
+ *     bytes 12-15  number of columns
+ *     bytes 16-    one bit per cell in row-major order, least significant
+ *                  bit first, 1 for corridor and 0 for wall; the last byte
+ *                  is zero-padded
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "grid.h"
+
+/*
+ * The parseMazeText function fills maze from the text of a maze file in
+ * one pass: '@' is a wall, '-' a corridor, one line per row, with either
+ * \n or \r\n line endings. Calls error() if the rows are ragged, a
+ * character is invalid, or the entrance and exit are not both open.
+ */
+void parseMazeText(const char* text, size_t length, Grid<bool>& maze);
+
+/*
+ * The parseMazeBinary function fills maze from the contents of a binary
+ * maze file (see layout above). Calls error() if the header is wrong or
+ * the data is truncated.
+ */
+void parseMazeBinary(const char* data, size_t length, Grid<bool>& maze);
+
+/*
+ * The isBinaryMaze function returns true if the data starts with the
+ * binary maze magic number.
+ */
+bool isBinaryMaze(const char* data, size_t length);
+
+/*
+ * The writeMazeFile function writes maze in the @/- text format accepted
+ * by readMazeFile, one line per row.
+ */
+void writeMazeFile(std::string filename, const Grid<bool>& maze);
+
+/*
+ * The writeMazeBinary function writes maze in the binary format, which is
+ * about 1/8 the size of the text format. readMazeFile recognizes binary
+ * files by their magic number, whatever their extension.
+ */
+void writeMazeBinary(std::string filename, const Grid<bool>& maze);
+
+/*
+ * The convertMazeToBinary function reads the text maze file textFile and
+ * writes the same maze in binary form to binaryFile.
+ */
+void convertMazeToBinary(std::string textFile, std::string binaryFile);
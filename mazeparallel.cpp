@@ -0,0 +1,374 @@
+/*
+ * File: mazeparallel.cpp
+ * ----------------------
+ * Level-synchronous parallel BFS over a flattened copy of the maze.
+ * Cells are numbered row * numCols + col. The parent of every reached cell
+ * is kept in one array of atomics (stored as parent + 1 so that zero means
+ * unvisited), which doubles as the visited set: in top-down steps a thread
+ * claims a neighbor by compare-and-swap, in bottom-up steps each thread owns
+ * a disjoint range of cells and so never races on a claim.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "error.h"
+#include "grid.h"
+#include "maze.h"
+#include "mazeparallel.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+// A level is split across the workers only if each gets at least this many cells
+// to look at, since waking them costs more than expanding a handful of cells.
+static const long kMinCellsPerThread = 256;
+
+// Direction-switch thresholds (after Beamer et al.): go bottom-up once the
+// frontier is more than 1/kAlpha of the unvisited cells, and return to
+// top-down once it drops below 1/kBeta of them.
+static const long kAlpha = 14;
+static const long kBeta = 24;
+
+/*
+ * A reusable barrier for a fixed number of threads. Every level of the search
+ * is bracketed by two waits: one to release the workers into the level and
+ * one to collect them once their share is expanded.
+ */
+struct LevelBarrier {
+    mutex lock;
+    condition_variable changed;
+    int numThreads;
+    int numArrived = 0;
+    long generation = 0;
+
+    explicit LevelBarrier(int n) : numThreads(n) {}
+
+    void arriveAndWait() {
+        unique_lock<mutex> guard(lock);
+        long myGeneration = generation;
+        if (++numArrived == numThreads) {
+            numArrived = 0;
+            generation++;
+            changed.notify_all();
+        } else {
+            changed.wait(guard, [&] { return generation != myGeneration; });
+        }
+    }
+};
+
+/*
+ * All state shared by the threads of one solve. Between the two barrier waits
+ * of a level the workers only read frontier, inFrontier, unvisitedCells and
+ * open, write their own localNext and localRemaining vectors, and claim cells
+ * in parent. In bottom-up levels only the open cells not yet reached are
+ * scanned. They are kept in unvisitedCells, which is built when the search
+ * turns bottom-up and shrinks by the cells each level claims.
+ */
+struct ParallelSearch {
+    int numRows;
+    int numCols;
+    long numCells;
+    vector<unsigned char> open;
+    unique_ptr<atomic<int>[]> parent;
+    vector<int> frontier;
+    vector<unsigned char> inFrontier;
+    vector<int> unvisitedCells;
+    vector<vector<int>> localNext;
+    vector<vector<int>> localRemaining;
+    bool bottomUp = false;
+    bool done = false;
+
+    /* Calls fn(neighbor) for each open cell adjacent to cell. */
+    template <typename Fn>
+    void forEachOpenNeighbor(int cell, Fn fn) const {
+        int row = cell / numCols;
+        int col = cell - row * numCols;
+        if (row > 0 && open[cell - numCols]) fn(cell - numCols);
+        if (col > 0 && open[cell - 1]) fn(cell - 1);
+        if (col < numCols - 1 && open[cell + 1]) fn(cell + 1);
+        if (row < numRows - 1 && open[cell + numCols]) fn(cell + numCols);
+    }
+
+    /* Returns the number of cells the current level looks at. */
+    long levelWork() const {
+        return bottomUp ? unvisitedCells.size() : frontier.size();
+    }
+
+    /* Expands share number part (of numParts) of the current level into localNext[part]. */
+    void expandShare(int part, int numParts) {
+        vector<int>& next = localNext[part];
+        long lo = levelWork() * part / numParts;
+        long hi = levelWork() * (part + 1) / numParts;
+        if (!bottomUp) {
+            for (long i = lo; i < hi; i++) {
+                int cell = frontier[i];
+                forEachOpenNeighbor(cell, [&](int neighbor) {
+                    int unvisited = 0;
+                    if (parent[neighbor].load(memory_order_relaxed) == 0
+                        && parent[neighbor].compare_exchange_strong(unvisited, cell + 1, memory_order_relaxed)) {
+                        next.push_back(neighbor);
+                    }
+                });
+            }
+        } else {
+            vector<int>& remaining = localRemaining[part];
+            for (long i = lo; i < hi; i++) {
+                int cell = unvisitedCells[i];
+                int found = -1;
+                forEachOpenNeighbor(cell, [&](int neighbor) {
+                    if (found < 0 && inFrontier[neighbor]) found = neighbor;
+                });
+                if (found >= 0) {
+                    parent[cell].store(found + 1, memory_order_relaxed);
+                    next.push_back(cell);
+                } else {
+                    remaining.push_back(cell);
+                }
+            }
+        }
+    }
+
+    /* Turns the search bottom-up, listing the open cells not yet reached. */
+    void startBottomUp() {
+        bottomUp = true;
+        inFrontier.assign(numCells, 0);
+        unvisitedCells.clear();
+        for (long cell = 0; cell < numCells; cell++) {
+            if (open[cell] && parent[cell].load(memory_order_relaxed) == 0) unvisitedCells.push_back(cell);
+        }
+    }
+};
+
+bool solveMazeParallelBFS(const Grid<bool>& maze, Vector<GridLocation>& soln, int numThreads,
+                          ParallelBFSTrace* trace) {
+    if (trace) *trace = ParallelBFSTrace();
+    if (maze.isEmpty()) return false;
+    if (numThreads <= 0) {
+        numThreads = max(1, int(thread::hardware_concurrency()));
+    }
+    if (long(maze.numRows()) * maze.numCols() > INT_MAX) {
+        error("solveMazeParallelBFS: maze has too many locations");
+    }
+
+    ParallelSearch search;
+    search.numRows = maze.numRows();
+    search.numCols = maze.numCols();
+    search.numCells = long(search.numRows) * search.numCols;
+    search.open.resize(search.numCells);
+    for (int r = 0; r < search.numRows; r++) {
+        for (int c = 0; c < search.numCols; c++) {
+            search.open[long(r) * search.numCols + c] = maze[r][c];
+        }
+    }
+    search.parent.reset(new atomic<int>[search.numCells]());
+    search.localNext.resize(numThreads);
+    search.localRemaining.resize(numThreads);
+
+    long unvisited = 0;
+    for (unsigned char cell : search.open) unvisited += cell;
+    const int exit = int(search.numCells - 1);
+    search.parent[0].store(1);
+    search.frontier.push_back(0);
+
+    LevelBarrier barrier(numThreads);
+    vector<thread> workers;
+    for (int t = 1; t < numThreads; t++) {
+        workers.emplace_back([&search, &barrier, t, numThreads]() {
+            while (true) {
+                barrier.arriveAndWait();
+                if (search.done) return;
+                search.expandShare(t, numThreads);
+                barrier.arriveAndWait();
+            }
+        });
+    }
+
+    while (!search.frontier.empty() && search.parent[exit].load() == 0) {
+        long frontierSize = search.frontier.size();
+        unvisited -= frontierSize;
+        if (!search.bottomUp && frontierSize * kAlpha > unvisited) {
+            search.startBottomUp();
+            if (trace) trace->directionSwitches++;
+        } else if (search.bottomUp && frontierSize * kBeta < unvisited) {
+            search.bottomUp = false;
+            if (trace) trace->directionSwitches++;
+        }
+        if (search.bottomUp) {
+            for (int cell : search.frontier) search.inFrontier[cell] = 1;
+        }
+
+        bool parallel = numThreads > 1 && search.levelWork() >= numThreads * kMinCellsPerThread;
+        if (parallel) {
+            barrier.arriveAndWait();
+            search.expandShare(0, numThreads);
+            barrier.arriveAndWait();
+        } else {
+            search.expandShare(0, 1);
+        }
+        if (trace) {
+            trace->numLevels++;
+            if (parallel) trace->parallelLevels++;
+            if (search.bottomUp) trace->bottomUpLevels++;
+        }
+
+        if (search.bottomUp) {
+            for (int cell : search.frontier) search.inFrontier[cell] = 0;
+            search.unvisitedCells.clear();
+            for (vector<int>& remaining : search.localRemaining) {
+                search.unvisitedCells.insert(search.unvisitedCells.end(), remaining.begin(), remaining.end());
+                remaining.clear();
+            }
+        }
+        search.frontier.clear();
+        for (vector<int>& next : search.localNext) {
+            search.frontier.insert(search.frontier.end(), next.begin(), next.end());
+            next.clear();
+        }
+    }
+
+    search.done = true;
+    if (numThreads > 1) barrier.arriveAndWait();
+    for (thread& t : workers) t.join();
+
+    if (search.parent[exit].load() == 0) return false;
+    vector<int> cells;
+    for (int cell = exit; ; cell = search.parent[cell].load() - 1) {
+        cells.push_back(cell);
+        if (cell == 0) break;
+    }
+    soln.clear();
+    for (auto it = cells.rbegin(); it != cells.rend(); ++it) {
+        soln.add(GridLocation(*it / search.numCols, *it % search.numCols));
+    }
+    return true;
+}
+
+void makeSyntheticMaze(Grid<bool>& maze, int rows, int cols, int wallPercent, unsigned seed) {
+    maze.resize(rows, cols);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            // integer hash of (seed, r, c) so the maze doesn't depend on a library RNG
+            unsigned h = seed ^ (unsigned(r) * 0x9E3779B1u) ^ (unsigned(c) * 0x85EBCA77u);
+            h ^= h >> 15;
+            h *= 0x2C1B3C6Du;
+            h ^= h >> 12;
+            h *= 0x297A2D39u;
+            h ^= h >> 15;
+            maze[r][c] = int(h % 100) >= wallPercent;
+        }
+    }
+    // open the top row and right column so there is always some path to the exit
+    for (int c = 0; c < cols; c++) maze[0][c] = true;
+    for (int r = 0; r < rows; r++) maze[r][cols - 1] = true;
+}
+
+void benchmarkParallelBFS(int size, int maxThreads, int wallPercent) {
+    if (maxThreads <= 0) {
+        maxThreads = max(1, int(thread::hardware_concurrency()));
+    }
+    ios::fmtflags oldFlags = cout.flags();
+    streamsize oldPrecision = cout.precision();
+    Grid<bool> maze;
+    makeSyntheticMaze(maze, size, size, wallPercent);
+    cout << "Parallel BFS on " << size << "x" << size << " synthetic maze, " << wallPercent << "% walls" << endl;
+
+    double baseMs = 0;
+    for (int threads = 1; ; threads = min(threads * 2, maxThreads)) {
+        Vector<GridLocation> soln;
+        ParallelBFSTrace trace;
+        auto start = chrono::steady_clock::now();
+        bool found = solveMazeParallelBFS(maze, soln, threads, &trace);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (threads == 1) baseMs = ms;
+        cout << setw(4) << threads << " threads: " << fixed << setprecision(1) << setw(10) << ms << " ms"
+             << "  speedup " << setprecision(2) << baseMs / ms
+             << "  path " << (found ? soln.size() : 0)
+             << "  levels " << trace.numLevels << " (" << trace.parallelLevels << " parallel, "
+             << trace.bottomUpLevels << " bottom-up)" << endl;
+        if (threads == maxThreads) break;
+    }
+    cout.flags(oldFlags);
+    cout.precision(oldPrecision);
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("solveMazeParallelBFS finds paths as short as solveMazeBFS on res/ mazes") {
+    for (string name : {"res/5x7.maze", "res/19x35.maze", "res/21x23.maze", "res/33x41.maze", "res/6x6.maze"}) {
+        Grid<bool> maze;
+        readMazeFile(name, maze);
+        Vector<GridLocation> expected;
+        bool solvable = solveMazeBFS(maze, expected);
+        for (int threads : {1, 3}) {
+            Vector<GridLocation> soln;
+            EXPECT_EQUAL(solveMazeParallelBFS(maze, soln, threads), solvable);
+            if (solvable) {
+                EXPECT_EQUAL(soln.size(), expected.size());
+                EXPECT_NO_ERROR(validatePath(maze, soln));
+            }
+        }
+    }
+}
+
+STUDENT_TEST("solveMazeParallelBFS switches direction on open synthetic mazes and keeps shortest length") {
+    Grid<bool> maze;
+    makeSyntheticMaze(maze, 300, 340, 5);
+    Vector<GridLocation> expected;
+    EXPECT(solveMazeBFS(maze, expected));
+    for (int threads : {1, 2, 4}) {
+        Vector<GridLocation> soln;
+        ParallelBFSTrace trace;
+        EXPECT(solveMazeParallelBFS(maze, soln, threads, &trace));
+        EXPECT_EQUAL(soln.size(), expected.size());
+        EXPECT_NO_ERROR(validatePath(maze, soln));
+        EXPECT_EQUAL(trace.numLevels, soln.size() - 1);
+        EXPECT(trace.directionSwitches >= 1);
+        EXPECT(trace.bottomUpLevels > 0);
+        if (threads == 1) EXPECT_EQUAL(trace.parallelLevels, 0);
+    }
+
+    // With walls too dense for the frontier to catch up, the search stays top-down
+    makeSyntheticMaze(maze, 300, 300, 20);
+    EXPECT(solveMazeBFS(maze, expected));
+    Vector<GridLocation> soln;
+    ParallelBFSTrace trace;
+    EXPECT(solveMazeParallelBFS(maze, soln, 2, &trace));
+    EXPECT_EQUAL(soln.size(), expected.size());
+    EXPECT_EQUAL(trace.bottomUpLevels, 0);
+
+    Grid<bool> single(1, 1, true);
+    EXPECT(solveMazeParallelBFS(single, soln, 2));
+    EXPECT_EQUAL(soln, {{0, 0}});
+}
+
+STUDENT_TEST("solveMazeParallelBFS splits wide levels across threads on the benchmark maze") {
+    Grid<bool> maze;
+    makeSyntheticMaze(maze, 2000, 2000, 5);
+    Vector<GridLocation> soln, expected;
+    ParallelBFSTrace trace;
+    EXPECT(solveMazeParallelBFS(maze, soln, 4, &trace));
+    EXPECT(solveMazeBFS(maze, expected));
+    EXPECT_EQUAL(soln.size(), expected.size());
+    EXPECT(trace.parallelLevels > 0);
+    EXPECT(trace.bottomUpLevels > 0);
+}
+
+STUDENT_TEST("solveMazeParallelBFS time by thread count (benchmarkParallelBFS prints the full table)") {
+    Grid<bool> maze;
+    makeSyntheticMaze(maze, 2000, 2000, 5);
+    for (int threads : {1, 2, 4}) {
+        Vector<GridLocation> soln;
+        TIME_OPERATION(threads, solveMazeParallelBFS(maze, soln, threads));
+        EXPECT_EQUAL(soln.size(), 3999);
+    }
+}
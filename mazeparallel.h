@@ -0,0 +1,57 @@
+/*
+ * File: mazeparallel.h
+ * --------------------
+ * Defines a multi-threaded breadth-first solver for very large mazes.
+ */
+
+#pragma once
+
+#include "grid.h"
+#include "vector.h"
+
+/*
+ * The ParallelBFSTrace struct counts how solveMazeParallelBFS ran its levels,
+ * so that benchmarks and tests can check which strategies were used.
+ */
+struct ParallelBFSTrace {
+    int numLevels = 0;
+    int parallelLevels = 0;      // levels split across the worker threads
+    int bottomUpLevels = 0;
+    int directionSwitches = 0;   // top-down to bottom-up or back
+};
+
+/*
+ * The solveMazeParallelBFS function solves a maze from the entry (upper left)
+ * to the exit (lower right) like solveMazeBFS, but expands each BFS level
+ * across numThreads worker threads (0 means one per hardware core). A level
+ * is only split if every thread gets a few hundred cells of it; smaller ones
+ * are expanded on the calling thread alone. Once the frontier gets large
+ * relative to the open cells not yet reached, the search switches from
+ * top-down (frontier pushes to neighbors) to bottom-up (unreached cells look
+ * for a parent in the frontier) and back again as it shrinks. Bottom-up
+ * levels only scan the cells still unreached, so they get cheaper as the
+ * search nears its end. trace, if not null, receives the level counts.
+ * The path found is a shortest path, so it always has the same length as the
+ * one from solveMazeBFS, though the two may differ where several shortest
+ * paths exist. Returns false if there is no path. Calls error() if the maze
+ * has more than INT_MAX locations.
+ */
+bool solveMazeParallelBFS(const Grid<bool>& maze, Vector<GridLocation>& soln, int numThreads = 0,
+                          ParallelBFSTrace* trace = nullptr);
+
+/*
+ * The makeSyntheticMaze function fills maze with a rows x cols benchmark
+ * maze: an open field with pseudo-random walls at the given density (0-100),
+ * derived only from seed so that every run sees the same maze. The top row
+ * and right column are left open so the maze is always solvable.
+ */
+void makeSyntheticMaze(Grid<bool>& maze, int rows, int cols, int wallPercent = 25, unsigned seed = 106);
+
+/*
+ * The benchmarkParallelBFS function solves a size x size synthetic maze
+ * with the given wall density using 1, 2, 4, ... up to maxThreads threads
+ * (0 means hardware cores). For each it prints the solve time, the speedup
+ * over the single-threaded run and how many levels ran in parallel and
+ * bottom-up.
+ */
+void benchmarkParallelBFS(int size, int maxThreads = 0, int wallPercent = 5);
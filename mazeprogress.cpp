@@ -0,0 +1,150 @@
+/*
+ * File: mazeprogress.cpp
+ * ----------------------
+ * The live viewer for solver progress. The solver runs on its own thread and
+ * only ever touches the MazeProgress; all graphics calls stay on the
+ * thread that called watchMazeSolve.
+ */
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include "grid.h"
+#include "maze.h"
+#include "mazegraphics.h"
+#include "mazeparallel.h"
+#include "mazeprogress.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+static const int kFramesPerSecond = 30;
+
+bool watchMazeSolve(Grid<bool>& maze, Vector<GridLocation>& soln, bool useDFS) {
+    initGraphicsForMaze(maze);
+    MazeProgress progress(maze.numRows(), maze.numCols());
+    atomic<bool> finished(false);
+    bool found = false;
+    exception_ptr failure;   // an error() in the solver is rethrown here rather than ending the program
+    thread solver([&]() {
+        try {
+            found = useDFS ? solveMazeDFS(maze, soln, &progress) : solveMazeBFS(maze, soln, &progress);
+        } catch (...) {
+            failure = current_exception();
+        }
+        finished.store(true, memory_order_release);
+    });
+
+    Vector<GridLocation> fresh;
+    auto frame = chrono::microseconds(1000000 / kFramesPerSecond);
+    while (!finished.load(memory_order_acquire)) {
+        this_thread::sleep_for(frame);
+        fresh.clear();
+        if (progress.popVisited(fresh) > 0) extendHighlight(fresh, "Light Blue");
+    }
+    solver.join();
+    if (failure) rethrow_exception(failure);
+
+    fresh.clear();
+    progress.popVisited(fresh);
+    extendHighlight(fresh, "Light Blue");
+    if (found) highlightPath(soln, "Green");
+    flushHighlights();
+    return found;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("SpscRing keeps order, refuses pushes when full and wraps around") {
+    SpscRing<int> ring(3);
+    EXPECT_EQUAL(int(ring.capacity()), 4);
+    for (int i = 0; i < 4; i++) EXPECT(ring.tryPush(i));
+    EXPECT(!ring.tryPush(4));
+    int value = -1;
+    EXPECT(ring.tryPop(value));
+    EXPECT_EQUAL(value, 0);
+    EXPECT(ring.tryPush(4));
+    int out[8];
+    EXPECT_EQUAL(int(ring.popMany(out, 8)), 4);
+    EXPECT_EQUAL(out[0], 1);
+    EXPECT_EQUAL(out[3], 4);
+    EXPECT(!ring.tryPop(value));
+}
+
+STUDENT_TEST("SpscRing passes every value across threads in order") {
+    SpscRing<long> ring(1024);
+    const long kCount = 100000;
+    thread producer([&]() {
+        for (long i = 0; i < kCount; i++) {
+            while (!ring.tryPush(i)) this_thread::yield();
+        }
+    });
+    long expected = 0;
+    bool inOrder = true;
+    while (expected < kCount) {
+        long value;
+        if (ring.tryPop(value)) {
+            inOrder = inOrder && value == expected;
+            expected++;
+        }
+    }
+    producer.join();
+    EXPECT(inOrder);
+}
+
+STUDENT_TEST("solvers report progress without changing their answers") {
+    Grid<bool> maze;
+    readMazeFile("res/21x23.maze", maze);
+    Vector<GridLocation> plain, reported;
+    MazeProgress progress(maze.numRows(), maze.numCols());
+    EXPECT(solveMazeBFS(maze, plain));
+    EXPECT(solveMazeBFS(maze, reported, &progress));
+    EXPECT_EQUAL(reported, plain);
+    EXPECT(progress.numFrontier() >= plain.size());
+
+    Vector<GridLocation> visited;
+    EXPECT(progress.popVisited(visited) >= plain.size());
+    EXPECT_EQUAL(visited[0], GridLocation(0, 0));
+    EXPECT_EQUAL(visited[visited.size() - 1], plain[plain.size() - 1]);
+    for (GridLocation loc : plain) EXPECT(progress.isVisited(loc));
+    EXPECT_EQUAL(int(progress.popVisited(visited)), 0);
+}
+
+STUDENT_TEST("MazeProgress keeps every visit of a large solve while the viewer lags behind") {
+    Grid<bool> maze;
+    makeSyntheticMaze(maze, 1000, 1000, 5);
+    MazeProgress progress(maze.numRows(), maze.numCols());
+    atomic<bool> finished(false);
+    Vector<GridLocation> soln;
+    thread solver([&]() {
+        solveMazeBFS(maze, soln, &progress);
+        finished.store(true, memory_order_release);
+    });
+    // A slow viewer only looks now and then, and gets each location once
+    Vector<GridLocation> visited;
+    while (!finished.load(memory_order_acquire)) {
+        this_thread::sleep_for(chrono::milliseconds(5));
+        progress.popVisited(visited);
+    }
+    solver.join();
+    progress.popVisited(visited);
+    EXPECT(!soln.isEmpty());
+
+    Grid<bool> seen(maze.numRows(), maze.numCols(), false);
+    bool distinct = true;
+    for (GridLocation loc : visited) {
+        distinct = distinct && !seen[loc];
+        seen[loc] = true;
+    }
+    EXPECT(distinct);
+    bool matchesMap = true;
+    for (int row = 0; row < maze.numRows(); row++) {
+        for (int col = 0; col < maze.numCols(); col++) {
+            matchesMap = matchesMap && bool(seen[row][col]) == progress.isVisited({row, col});
+        }
+    }
+    EXPECT(matchesMap);
+    for (GridLocation loc : soln) EXPECT(seen[loc]);
+}
@@ -0,0 +1,158 @@
+/*
+ * File: mazeprogress.h
+ * --------------------
+ * Defines the channel a solver uses to report its progress to a viewer
+ * running on another thread, without ever waiting for the viewer.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "grid.h"
+#include "vector.h"
+
+/*
+ * The SpscRing class is a fixed-capacity lock-free queue for exactly one
+ * producer thread and one consumer thread. Neither side ever blocks: tryPush
+ * fails when the ring is full and tryPop fails when it is empty. Capacity is
+ * rounded up to a power of two. The head and tail counters live on separate
+ * cache lines so the two threads don't contend on the same line.
+ */
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size *= 2;
+        _mask = size - 1;
+        _slots.reset(new T[size]);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const {
+        return _mask + 1;
+    }
+
+    /* Producer only: adds value and returns true, or returns false if full. */
+    bool tryPush(const T& value) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _cachedHead > _mask) {
+            _cachedHead = _head.load(std::memory_order_acquire);
+            if (tail - _cachedHead > _mask) return false;
+        }
+        _slots[tail & _mask] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Consumer only: removes the oldest value into value and returns true, or returns false if empty. */
+    bool tryPop(T& value) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) return false;
+        value = _slots[head & _mask];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Consumer only: removes up to max of the oldest values into out, returning how many. */
+    size_t popMany(T* out, size_t max) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t available = _tail.load(std::memory_order_acquire) - head;
+        size_t count = available < max ? available : max;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = _slots[(head + i) & _mask];
+        }
+        _head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    std::unique_ptr<T[]> _slots;
+    size_t _mask;
+    alignas(64) std::atomic<size_t> _head{0};
+    size_t _cachedHead = 0;              // producer's last view of _head
+    alignas(64) std::atomic<size_t> _tail{0};
+};
+
+/*
+ * Kinds of solver events: a location joining the frontier (queued or stacked
+ * for later), or a location being visited (taken off the frontier and expanded).
+ */
+enum MazeEventKind : unsigned char {
+    MAZE_FRONTIER,
+    MAZE_VISITED
+};
+
+/*
+ * The MazeProgress class is the channel between one solver and one viewer.
+ * Rather than queue every event, the solver coalesces them into state the
+ * viewer can catch up on at any time: frontier events only bump a counter,
+ * and each location's first visit sets its flag in a shared visited map
+ * and pushes its cell number (row * numCols + col) onto a ring sized to
+ * hold every location. A location is pushed at most once, so the ring can
+ * never fill, no visit is ever lost, and the solver never waits. The
+ * viewer pops only the locations visited since it last looked.
+ */
+class MazeProgress {
+public:
+    MazeProgress(int numRows, int numCols)
+        : _numCols(numCols), _visited(size_t(numRows) * numCols), _newlyVisited(size_t(numRows) * numCols) {}
+
+    /* Solver only: records an event at loc, which must be inside the maze. */
+    void report(MazeEventKind kind, GridLocation loc) {
+        if (kind == MAZE_FRONTIER) {
+            _numFrontier.store(_numFrontier.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        int cell = loc.row * _numCols + loc.col;
+        if (_visited[cell].load(std::memory_order_relaxed)) return;
+        _visited[cell].store(true, std::memory_order_relaxed);
+        _newlyVisited.tryPush(cell);
+    }
+
+    /* Returns whether loc has been visited so far. */
+    bool isVisited(GridLocation loc) const {
+        return _visited[size_t(loc.row) * _numCols + loc.col].load(std::memory_order_relaxed);
+    }
+
+    /* The number of frontier events reported so far. */
+    long numFrontier() const {
+        return _numFrontier.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Viewer only: appends to locs every location first visited since the
+     * last call, in the order they were visited, and returns how many.
+     */
+    size_t popVisited(Vector<GridLocation>& locs) {
+        size_t count = 0;
+        int cell;
+        while (_newlyVisited.tryPop(cell)) {
+            locs.add(GridLocation(cell / _numCols, cell % _numCols));
+            count++;
+        }
+        return count;
+    }
+
+private:
+    int _numCols;
+    std::vector<std::atomic<bool>> _visited;
+    SpscRing<int> _newlyVisited;
+    std::atomic<long> _numFrontier{0};
+};
+
+/*
+ * The watchMazeSolve function solves maze with solveMazeBFS (or solveMazeDFS
+ * if useDFS is true) on a background thread while the calling thread draws
+ * its progress: about 30 times a second it highlights the locations visited
+ * since the previous frame, so each frame costs time proportional to what
+ * changed rather than to everything visited so far. When the solve
+ * finishes the solution path is highlighted. Returns whether a solution
+ * was found.
+ */
+bool watchMazeSolve(Grid<bool>& maze, Vector<GridLocation>& soln, bool useDFS = false);
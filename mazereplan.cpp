@@ -0,0 +1,355 @@
+/*
+ * File: mazereplan.cpp
+ * --------------------
+ * LPA* on the four-connected maze, with every move costing 1. The queue
+ * is a binary heap without decrease-key. A location is pushed again each
+ * time its key changes, and an entry is skipped when popped unless the
+ * location is still inconsistent and the entry's key is still its key.
+ * Distances saturate at kInfinity, which is small enough that adding a
+ * heuristic to it cannot overflow.
+ */
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include "error.h"
+#include "grid.h"
+#include "maze.h"
+#include "mazegenerator.h"
+#include "mazeparallel.h"
+#include "mazereplan.h"
+#include "mazestats.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+static const int kInfinity = INT_MAX / 4;
+static const int kRowStep[4] = {-1, 0, 0, 1};
+static const int kColStep[4] = {0, -1, 1, 0};
+
+const size_t MazeReplanner::kMaxQueuePerCell;
+
+bool MazeReplanner::Entry::operator>(const Entry& other) const {
+    return key1 != other.key1 ? key1 > other.key1 : key2 > other.key2;
+}
+
+MazeReplanner::MazeReplanner(const Grid<bool>& maze) : _numRows(maze.numRows()), _numCols(maze.numCols()) {
+    long numCells = long(_numRows) * _numCols;
+    _open.reserve(numCells);
+    for (bool open : maze) {
+        _open.push_back(open);
+    }
+    _g.assign(numCells, kInfinity);
+    _rhs.assign(numCells, kInfinity);
+    if (numCells > 0) updateCell(0);
+}
+
+int MazeReplanner::cellOf(GridLocation loc) const {
+    if (loc.row < 0 || loc.row >= _numRows || loc.col < 0 || loc.col >= _numCols) {
+        error("MazeReplanner: location is outside the maze");
+    }
+    return loc.row * _numCols + loc.col;
+}
+
+bool MazeReplanner::isOpen(GridLocation loc) const {
+    return _open[cellOf(loc)];
+}
+
+void MazeReplanner::setOpen(GridLocation loc, bool open) {
+    int cell = cellOf(loc);
+    if (bool(_open[cell]) == open) return;
+    _open[cell] = open;
+    updateCell(cell);
+    updateNeighbors(cell);
+}
+
+void MazeReplanner::toggle(const Vector<GridLocation>& locs) {
+    for (GridLocation loc : locs) {
+        setOpen(loc, !isOpen(loc));
+    }
+}
+
+/* The number of moves from cell to the exit if there were no walls. */
+int MazeReplanner::heuristic(int cell) const {
+    return (_numRows - 1 - cell / _numCols) + (_numCols - 1 - cell % _numCols);
+}
+
+MazeReplanner::Entry MazeReplanner::keyOf(int cell) const {
+    int best = min(_g[cell], _rhs[cell]);
+    return {best >= kInfinity ? kInfinity : best + heuristic(cell), best, cell};
+}
+
+/* Recomputes rhs for cell from its open neighbors, and queues it if that leaves it inconsistent. */
+void MazeReplanner::updateCell(int cell) {
+    if (cell == 0) {
+        _rhs[0] = _open[0] ? 0 : kInfinity;
+    } else {
+        int best = kInfinity;
+        if (_open[cell]) {
+            int row = cell / _numCols;
+            int col = cell % _numCols;
+            for (int dir = 0; dir < 4; dir++) {
+                int r = row + kRowStep[dir];
+                int c = col + kColStep[dir];
+                if (r < 0 || r >= _numRows || c < 0 || c >= _numCols) continue;
+                int next = r * _numCols + c;
+                if (_open[next] && _g[next] + 1 < best) best = _g[next] + 1;
+            }
+        }
+        _rhs[cell] = best;
+    }
+    if (_g[cell] != _rhs[cell]) {
+        _queue.push_back(keyOf(cell));
+        push_heap(_queue.begin(), _queue.end(), greater<Entry>());
+        if (_queue.size() > kMaxQueuePerCell * _g.size()) compactQueue();
+    }
+}
+
+/*
+ * Rebuilds the queue with one entry, at its current key, for each
+ * inconsistent location. Every inconsistent location has an up-to-date
+ * entry somewhere in the queue, so nothing still needed is lost.
+ */
+void MazeReplanner::compactQueue() {
+    vector<unsigned char> kept(_g.size(), false);
+    size_t size = 0;
+    for (const Entry& entry : _queue) {
+        int cell = entry.cell;
+        if (_g[cell] != _rhs[cell] && !kept[cell]) {
+            kept[cell] = true;
+            _queue[size++] = keyOf(cell);
+        }
+    }
+    _queue.resize(size);
+    make_heap(_queue.begin(), _queue.end(), greater<Entry>());
+}
+
+void MazeReplanner::updateNeighbors(int cell) {
+    int row = cell / _numCols;
+    int col = cell % _numCols;
+    for (int dir = 0; dir < 4; dir++) {
+        int r = row + kRowStep[dir];
+        int c = col + kColStep[dir];
+        if (r >= 0 && r < _numRows && c >= 0 && c < _numCols) updateCell(r * _numCols + c);
+    }
+}
+
+/*
+ * Expands inconsistent locations in key order until the exit is
+ * consistent and nothing left in the queue could improve on it. Returns
+ * the number of locations expanded, and raises peakQueue to the largest
+ * the queue grew.
+ */
+long MazeReplanner::computeShortestPath(long& peakQueue) {
+    int exit = _g.size() - 1;
+    long expanded = 0;
+    while (!_queue.empty()) {
+        peakQueue = max(peakQueue, long(_queue.size()));
+        Entry top = _queue.front();
+        Entry current = keyOf(top.cell);
+        if (_g[top.cell] == _rhs[top.cell] || current > top || top > current) {
+            pop_heap(_queue.begin(), _queue.end(), greater<Entry>());   // out of date
+            _queue.pop_back();
+            continue;
+        }
+        if (!(keyOf(exit) > top) && _g[exit] == _rhs[exit]) break;
+        pop_heap(_queue.begin(), _queue.end(), greater<Entry>());
+        _queue.pop_back();
+        expanded++;
+        int cell = top.cell;
+        if (_g[cell] > _rhs[cell]) {
+            _g[cell] = _rhs[cell];
+        } else {
+            _g[cell] = kInfinity;
+            updateCell(cell);
+        }
+        updateNeighbors(cell);
+    }
+    return expanded;
+}
+
+bool MazeReplanner::solve(Vector<GridLocation>& soln, SolveStats* stats) {
+    soln.clear();
+    bool tracking = statsEnabled(stats);
+    PhaseTimer timer(tracking);
+    long peakQueue = 0;
+    long expanded = _g.empty() ? 0 : computeShortestPath(peakQueue);
+    double solveMs = timer.lapMs();
+
+    int exit = _g.size() - 1;
+    bool solved = exit >= 0 && _g[exit] < kInfinity;
+    if (solved) {
+        // Walk back from the exit, each step to a neighbor one move closer to the entry
+        vector<GridLocation> path;
+        int cell = exit;
+        path.push_back({cell / _numCols, cell % _numCols});
+        while (cell != 0) {
+            int row = cell / _numCols;
+            int col = cell % _numCols;
+            int prev = -1;
+            for (int dir = 0; dir < 4 && prev < 0; dir++) {
+                int r = row + kRowStep[dir];
+                int c = col + kColStep[dir];
+                if (r < 0 || r >= _numRows || c < 0 || c >= _numCols) continue;
+                int next = r * _numCols + c;
+                if (_open[next] && _g[next] == _g[cell] - 1) prev = next;
+            }
+            if (prev < 0) {
+                error("MazeReplanner: search state is inconsistent");
+            }
+            cell = prev;
+            path.push_back({cell / _numCols, cell % _numCols});
+        }
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            soln.add(*it);
+        }
+    }
+    if (tracking) {
+        stats->nodesExpanded = expanded;
+        stats->peakFrontier = peakQueue;
+        stats->peakBytes = _open.size() + (_g.size() + _rhs.size()) * sizeof(int) + _queue.capacity() * sizeof(Entry)
+                           + 2 * soln.size() * sizeof(GridLocation);
+        stats->solveMs = solveMs;
+        stats->reconstructMs = timer.lapMs();
+        stats->pathLength = soln.size();
+    }
+    return solved;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("MazeReplanner matches solveMazeBFS on res/ mazes and follows wall changes") {
+    for (string name : {"res/5x7.maze", "res/21x23.maze", "res/33x41.maze", "res/6x6.maze"}) {
+        Grid<bool> maze;
+        readMazeFile(name, maze);
+        MazeReplanner planner(maze);
+        Vector<GridLocation> soln, expected;
+        EXPECT_EQUAL(planner.solve(soln), solveMazeBFS(maze, expected));
+        EXPECT_EQUAL(soln.size(), expected.size());
+        if (!soln.isEmpty()) EXPECT_NO_ERROR(validatePath(maze, soln));
+    }
+
+    // Closing the only corridor and opening it again
+    Grid<bool> corridor = {{true, true, true},
+                           {false, false, true},
+                           {true, true, true}};
+    MazeReplanner planner(corridor);
+    Vector<GridLocation> soln;
+    EXPECT(planner.solve(soln));
+    EXPECT_EQUAL(soln.size(), 5);
+    planner.setOpen({1, 2}, false);
+    EXPECT(!planner.solve(soln));
+    EXPECT(soln.isEmpty());
+    planner.toggle({{1, 2}, {1, 0}});
+    EXPECT(planner.solve(soln));
+    EXPECT_EQUAL(soln.size(), 5);
+    planner.setOpen({1, 1}, true);
+    EXPECT(planner.solve(soln));
+    EXPECT_EQUAL(soln.size(), 5);
+    EXPECT_ERROR(planner.setOpen({3, 0}, true));
+}
+
+STUDENT_TEST("MazeReplanner paths stay as short as a fresh BFS through random batches of toggles") {
+    mt19937 random(106);
+    for (MazeStyle style : {MAZE_ROOMS, MAZE_BACKTRACKER}) {
+        Grid<bool> maze;
+        generateMaze(maze, 41, 61, style, 7);
+        MazeReplanner planner(maze);
+        for (int round = 0; round < 60; round++) {
+            Vector<GridLocation> changes;
+            int batch = 1 + random() % 6;
+            for (int i = 0; i < batch; i++) {
+                GridLocation loc(random() % maze.numRows(), random() % maze.numCols());
+                changes.add(loc);
+                maze[loc.row][loc.col] = !maze[loc.row][loc.col];
+            }
+            planner.toggle(changes);
+            Vector<GridLocation> soln, expected;
+            bool solvable = solveMazeBFS(maze, expected);
+            EXPECT_EQUAL(planner.solve(soln), solvable);
+            EXPECT_EQUAL(soln.size(), expected.size());
+            if (solvable) EXPECT_NO_ERROR(validatePath(maze, soln));
+        }
+    }
+}
+
+STUDENT_TEST("MazeReplanner queue stays within two entries per location over many edits") {
+    Grid<bool> maze;
+    generateMaze(maze, 21, 31, MAZE_BACKTRACKER, 7);
+    long numCells = maze.numRows() * maze.numCols();
+    MazeReplanner planner(maze);
+    mt19937 random(106);
+    long peak = 0;
+    Vector<GridLocation> spots;
+    while (spots.size() < 10) {
+        // Walls beside an open location, so opening one changes its distance
+        GridLocation loc(1 + random() % (maze.numRows() - 2), 1 + random() % (maze.numCols() - 2));
+        if (!maze[loc.row][loc.col] && (maze[loc.row - 1][loc.col] || maze[loc.row][loc.col - 1])) {
+            spots.add(loc);
+        }
+    }
+    for (int round = 0; round < 20000; round++) {
+        // Entries for locations off the shortest path are never popped, so each
+        // flip of the same few locations leaves another stale entry behind
+        planner.toggle({spots[random() % spots.size()]});
+        Vector<GridLocation> soln;
+        SolveStats stats;
+        planner.solve(soln, &stats);
+        peak = max(peak, stats.peakFrontier);
+    }
+    EXPECT(peak <= 2 * numCells + 1);
+    for (GridLocation loc : spots) {
+        maze[loc.row][loc.col] = planner.isOpen(loc);
+    }
+    Vector<GridLocation> soln, expected;
+    EXPECT_EQUAL(planner.solve(soln), solveMazeBFS(maze, expected));
+    EXPECT_EQUAL(soln.size(), expected.size());
+}
+
+STUDENT_TEST("MazeReplanner replan cost vs the initial search and a fresh BFS") {
+    Grid<bool> maze;
+    makeSyntheticMaze(maze, 1001, 1001);
+    MazeReplanner planner(maze);
+    Vector<GridLocation> soln, expected;
+    SolveStats initial;
+    TIME_OPERATION(maze.numRows() * maze.numCols(), planner.solve(soln, &initial));
+
+    mt19937 random(106);
+    vector<long> expansions;
+    for (int round = 0; round < 100; round++) {
+        GridLocation loc(1 + random() % (maze.numRows() - 1), random() % (maze.numCols() - 1));
+        maze[loc.row][loc.col] = !maze[loc.row][loc.col];
+        planner.toggle({loc});
+        SolveStats stats;
+        EXPECT(planner.solve(soln, &stats));
+        expansions.push_back(stats.nodesExpanded);
+        if (round % 20 == 0) {
+            EXPECT(solveMazeBFS(maze, expected));
+            EXPECT_EQUAL(soln.size(), expected.size());
+        }
+    }
+    TIME_OPERATION(maze.numRows() * maze.numCols(), solveMazeBFS(maze, expected));
+    EXPECT_EQUAL(soln.size(), expected.size());
+    sort(expansions.begin(), expansions.end());
+    long median = expansions[expansions.size() / 2];
+    EXPECT(median * 100 < initial.nodesExpanded);
+
+    // Blocking the current path forces a detour, the costliest kind of change
+    expansions.clear();
+    for (int round = 0; round < 20 && !soln.isEmpty(); round++) {
+        GridLocation loc = soln[soln.size() / 2];
+        maze[loc.row][loc.col] = false;
+        planner.setOpen(loc, false);
+        SolveStats stats;
+        EXPECT_EQUAL(planner.solve(soln, &stats), solveMazeBFS(maze, expected));
+        EXPECT_EQUAL(soln.size(), expected.size());
+        expansions.push_back(stats.nodesExpanded);
+    }
+    if (!expansions.empty()) {
+        sort(expansions.begin(), expansions.end());
+        EXPECT(expansions[expansions.size() / 2] < initial.nodesExpanded);
+    }
+}
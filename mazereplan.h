@@ -0,0 +1,84 @@
+/*
+ * File: mazereplan.h
+ * ------------------
+ * Defines a maze solver that keeps its search between calls, for mazes
+ * whose walls change while they are being solved. It runs Lifelong
+ * Planning A* (LPA*) from the entry to the exit, with the Manhattan
+ * distance to the exit as its heuristic. Each location keeps g, its
+ * distance as last settled, and rhs, the distance its neighbors' g values
+ * imply. When walls change only the locations around the change become
+ * inconsistent (g != rhs), and the next solve re-expands just those and
+ * whatever they affect on the way to the exit. The rest of the previous
+ * search is reused as it stands.
+ */
+
+#pragma once
+
+#include <vector>
+#include "grid.h"
+#include "vector.h"
+
+struct SolveStats;
+
+class MazeReplanner {
+public:
+    /* Starts planning on a copy of maze; nothing is searched until solve. */
+    explicit MazeReplanner(const Grid<bool>& maze);
+
+    int numRows() const {
+        return _numRows;
+    }
+
+    int numCols() const {
+        return _numCols;
+    }
+
+    /* Returns whether loc is open. Calls error() if loc is outside the maze. */
+    bool isOpen(GridLocation loc) const;
+
+    /*
+     * Makes loc open or a wall. The search is only repaired on the next
+     * solve, so any number of changes can be batched. Calls error() if loc
+     * is outside the maze.
+     */
+    void setOpen(GridLocation loc, bool open);
+
+    /* Flips every location in locs between open and wall. */
+    void toggle(const Vector<GridLocation>& locs);
+
+    /*
+     * The solve function brings the search up to date with the changes
+     * made since the last solve. It stores a shortest path from the entry
+     * to the exit in soln and returns true, or returns false if there is
+     * none. The path is as long as the one solveMazeBFS finds, though it
+     * may differ where several shortest paths exist. stats, if not null, is
+     * filled in (see mazestats.h); nodesExpanded counts only this call's
+     * expansions.
+     */
+    bool solve(Vector<GridLocation>& soln, SolveStats* stats = nullptr);
+
+private:
+    /* The queue is compacted when it holds more than this many entries per location. */
+    static const size_t kMaxQueuePerCell = 2;
+
+    struct Entry {
+        int key1;   // min(g, rhs) + heuristic
+        int key2;   // min(g, rhs)
+        int cell;
+        bool operator>(const Entry& other) const;
+    };
+
+    int cellOf(GridLocation loc) const;
+    int heuristic(int cell) const;
+    Entry keyOf(int cell) const;
+    void updateCell(int cell);
+    void updateNeighbors(int cell);
+    void compactQueue();
+    long computeShortestPath(long& peakQueue);
+
+    int _numRows, _numCols;
+    std::vector<unsigned char> _open;
+    std::vector<int> _g;
+    std::vector<int> _rhs;
+    std::vector<Entry> _queue;   // a min-heap; entries whose key is out of date are skipped
+};
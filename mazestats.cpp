@@ -0,0 +1,250 @@
+/*
+ * File: mazestats.cpp
+ * -------------------
+ * The run-wide statistics table and its CSV and JSON output. Numbers are
+ * written with enough precision to round-trip the millisecond timings to
+ * the microsecond.
+ */
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "error.h"
+#include "filelib.h"
+#include "grid.h"
+#include "gridsearch.h"
+#include "maze.h"
+#include "mazegenerator.h"
+#include "mazegraph.h"
+#include "mazestats.h"
+#include "strlib.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+void SolveStatsTable::add(const string& name, const SolveStats& stats) {
+    _names.add(name);
+    _rows.add(stats);
+}
+
+int SolveStatsTable::size() const {
+    return _rows.size();
+}
+
+const string& SolveStatsTable::name(int i) const {
+    return _names[i];
+}
+
+const SolveStats& SolveStatsTable::stats(int i) const {
+    return _rows[i];
+}
+
+SolveStats SolveStatsTable::total() const {
+    SolveStats sum;
+    for (const SolveStats& row : _rows) {
+        sum.nodesExpanded += row.nodesExpanded;
+        sum.peakFrontier = max(sum.peakFrontier, row.peakFrontier);
+        sum.peakBytes = max(sum.peakBytes, row.peakBytes);
+        sum.parseMs += row.parseMs;
+        sum.solveMs += row.solveMs;
+        sum.reconstructMs += row.reconstructMs;
+        sum.pathLength += row.pathLength;
+    }
+    return sum;
+}
+
+static const char* const kColumns[] = {"nodesExpanded", "peakFrontier", "peakBytes", "parseMs",
+                                       "solveMs", "reconstructMs", "pathLength"};
+
+/* Writes the fields of stats in the order of kColumns, each preceded by separator(i). */
+template <typename Separator>
+static void writeFields(ostream& out, const SolveStats& stats, Separator separator) {
+    out << separator(0) << stats.nodesExpanded
+        << separator(1) << stats.peakFrontier
+        << separator(2) << stats.peakBytes
+        << separator(3) << stats.parseMs
+        << separator(4) << stats.solveMs
+        << separator(5) << stats.reconstructMs
+        << separator(6) << stats.pathLength;
+}
+
+/* Quotes a CSV field if it holds a comma, quote or line break. */
+static string csvField(const string& text) {
+    if (text.find_first_of(",\"\r\n") == string::npos) return text;
+    string quoted = "\"";
+    for (char ch : text) {
+        if (ch == '"') quoted += '"';
+        quoted += ch;
+    }
+    return quoted + "\"";
+}
+
+static string jsonString(const string& text) {
+    ostringstream out;
+    out << '"';
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            out << '\\' << ch;
+        } else if ((unsigned char) ch < 0x20) {
+            out << "\\u" << hex << setw(4) << setfill('0') << int(ch) << dec << setfill(' ');
+        } else {
+            out << ch;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+void SolveStatsTable::writeCsv(ostream& out) const {
+    ios::fmtflags oldFlags = out.flags();
+    streamsize oldPrecision = out.precision();
+    out << fixed << setprecision(3) << "name";
+    for (const char* column : kColumns) out << ',' << column;
+    out << '\n';
+    for (int i = 0; i < size(); i++) {
+        out << csvField(_names[i]);
+        writeFields(out, _rows[i], [](int) { return ","; });
+        out << '\n';
+    }
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
+
+/* Writes stats as one JSON object, with name first if it is given. */
+static void writeJsonObject(ostream& out, const string* name, const SolveStats& stats) {
+    out << '{';
+    if (name) out << "\"name\": " << jsonString(*name) << ", ";
+    writeFields(out, stats, [](int i) { return string(i > 0 ? ", " : "") + "\"" + kColumns[i] + "\": "; });
+    out << '}';
+}
+
+void SolveStatsTable::writeJson(ostream& out) const {
+    ios::fmtflags oldFlags = out.flags();
+    streamsize oldPrecision = out.precision();
+    out << fixed << setprecision(3) << "{\"rows\": [";
+    for (int i = 0; i < size(); i++) {
+        out << (i > 0 ? ",\n  " : "\n  ");
+        writeJsonObject(out, &_names[i], _rows[i]);
+    }
+    out << "],\n \"total\": ";
+    writeJsonObject(out, nullptr, total());
+    out << "}\n";
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
+
+void SolveStatsTable::writeFile(const string& filename) const {
+    ofstream out(filename);
+    if (!out) {
+        error("Cannot write stats file " + filename);
+    }
+    if (endsWith(filename, ".json")) {
+        writeJson(out);
+    } else {
+        writeCsv(out);
+    }
+    if (!out) {
+        error("Error writing stats file " + filename);
+    }
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("SolveStatsTable totals rows and writes CSV and JSON") {
+    SolveStatsTable table;
+    SolveStats a, b;
+    a.nodesExpanded = 10;
+    a.peakFrontier = 4;
+    a.peakBytes = 100;
+    a.solveMs = 1.5;
+    a.pathLength = 7;
+    b.nodesExpanded = 5;
+    b.peakFrontier = 6;
+    b.peakBytes = 80;
+    b.parseMs = 0.25;
+    table.add("res/a.maze", a);
+    table.add("odd, \"name\"", b);
+    SolveStats total = table.total();
+    EXPECT_EQUAL(total.nodesExpanded, 15);
+    EXPECT_EQUAL(total.peakFrontier, 6);
+    EXPECT_EQUAL(total.peakBytes, 100);
+    EXPECT_EQUAL(total.pathLength, 7);
+
+    ostringstream csv;
+    table.writeCsv(csv);
+    EXPECT_EQUAL(csv.str(),
+                 "name,nodesExpanded,peakFrontier,peakBytes,parseMs,solveMs,reconstructMs,pathLength\n"
+                 "res/a.maze,10,4,100,0.000,1.500,0.000,7\n"
+                 "\"odd, \"\"name\"\"\",5,6,80,0.250,0.000,0.000,0\n");
+
+    ostringstream json;
+    table.writeJson(json);
+    EXPECT(startsWith(json.str(), "{\"rows\": [\n  {\"name\": \"res/a.maze\", \"nodesExpanded\": 10, "));
+    EXPECT(stringContains(json.str(), "{\"name\": \"odd, \\\"name\\\"\", \"nodesExpanded\": 5, "));
+    EXPECT(stringContains(json.str(), "\"total\": {\"nodesExpanded\": 15, \"peakFrontier\": 6, \"peakBytes\": 100, "));
+
+    table.writeFile("res/_stats.json");
+    EXPECT(fileExists("res/_stats.json"));
+    deleteFile("res/_stats.json");
+    EXPECT_ERROR(table.writeFile("res/no_such_dir/_stats.csv"));
+}
+
+STUDENT_TEST("Solvers fill in stats without changing their answers") {
+    Grid<bool> maze;
+    readMazeFile("res/33x41.maze", maze);
+    long numOpen = 0;
+    for (bool open : maze) numOpen += open;
+
+    Vector<GridLocation> expected, soln;
+    SolveStats stats;
+    EXPECT(solveMazeBFS(maze, expected));
+    EXPECT(solveMazeBFS(maze, soln, nullptr, &stats));
+    EXPECT_EQUAL(soln, expected);
+    EXPECT_EQUAL(stats.pathLength, soln.size());
+    EXPECT(stats.nodesExpanded >= soln.size() && stats.nodesExpanded <= numOpen);
+    EXPECT(stats.peakFrontier >= 1 && stats.peakFrontier <= numOpen);
+    EXPECT(stats.peakBytes >= maze.numRows() * maze.numCols());
+    EXPECT(stats.solveMs >= 0 && stats.reconstructMs >= 0);
+
+    stats = SolveStats();
+    EXPECT(solveMazeDFS(maze, expected));
+    EXPECT(solveMazeDFS(maze, soln, nullptr, &stats));
+    EXPECT_EQUAL(soln, expected);
+    EXPECT_EQUAL(stats.pathLength, soln.size());
+    EXPECT(stats.nodesExpanded >= 1 && stats.nodesExpanded <= numOpen);
+
+    stats = SolveStats();
+    solveMazeBFS(maze, expected);
+    EXPECT(solveMazeJunctions(maze, soln, &stats));
+    EXPECT_EQUAL(soln.size(), expected.size());
+    EXPECT_EQUAL(stats.pathLength, soln.size());
+    EXPECT(stats.nodesExpanded >= 1);
+    EXPECT(stats.peakBytes > 0);
+
+    // No path: the whole reachable region is expanded and nothing is reconstructed
+    readMazeFile("res/6x6.maze", maze);
+    stats = SolveStats();
+    EXPECT(!solveMazeBFS(maze, soln, nullptr, &stats));
+    EXPECT_EQUAL(stats.pathLength, 0);
+    EXPECT(stats.nodesExpanded >= 1);
+}
+
+/* Solves maze count times, with stats recorded into stats when it is not null. */
+static void solveRepeatedly(Grid<bool>& maze, int count, SolveStats* stats) {
+    Vector<GridLocation> soln;
+    for (int i = 0; i < count; i++) {
+        solveMazeBFS(maze, soln, nullptr, stats);
+    }
+}
+
+STUDENT_TEST("solveMazeBFS time with and without stats") {
+    Grid<bool> maze;
+    generateMaze(maze, 2001, 2001, MAZE_BACKTRACKER);
+    SolveStats stats;
+    TIME_OPERATION(maze.numRows() * maze.numCols(), solveRepeatedly(maze, 5, nullptr));
+    TIME_OPERATION(maze.numRows() * maze.numCols(), solveRepeatedly(maze, 5, &stats));
+    EXPECT(stats.pathLength > 0);
+    EXPECT(stats.nodesExpanded >= stats.pathLength);
+}
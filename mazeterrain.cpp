@@ -0,0 +1,328 @@
+/*
+ * File: mazeterrain.cpp
+ * ---------------------
+ * Terrain loading and Dial's algorithm. The solver packs all of its
+ * per-location state into one byte:
+ *     bits 0-3   cost to enter (0 for a wall)
+ *     bits 4-5   direction back to the location it was reached from
+ *     bit 7      settled (its cheapest cost is known)
+ * Bucket entries are (cell << 2 | direction back), so a location may be
+ * queued several times at different costs. Only its first appearance,
+ * which is the cheapest, settles it; the rest are skipped when reached.
+ */
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <vector>
+#include "error.h"
+#include "filecontents.h"
+#include "filelib.h"
+#include "grid.h"
+#include "maze.h"
+#include "mazeterrain.h"
+#include "strlib.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+static const int kRowStep[4] = {-1, 0, 0, 1};
+static const int kColStep[4] = {0, -1, 1, 0};
+
+static const unsigned char kCostBits = 0x0F;
+static const int kBackShift = 4;
+static const unsigned char kSettled = 0x80;
+
+/* Returns the cost for a terrain character, or -1 if it is not one. */
+static int costForChar(char ch) {
+    if (ch == '@') return 0;
+    if (ch == '-') return 1;
+    if (ch >= '1' && ch <= '0' + kMaxTerrainCost) return ch - '0';
+    return -1;
+}
+
+void parseTerrainText(const char* text, size_t length, Grid<unsigned char>& costs) {
+    // one trailing line ending is optional
+    if (length > 0 && text[length - 1] == '\n') length--;
+    if (length > 0 && text[length - 1] == '\r') length--;
+    if (length == 0) {
+        error("Terrain file is empty");
+    }
+    int numRows = 1;
+    for (const char* p = text; (p = static_cast<const char*>(memchr(p, '\n', text + length - p))); p++) {
+        numRows++;
+    }
+    const char* newline = static_cast<const char*>(memchr(text, '\n', length));
+    size_t numCols = (newline ? newline : text + length) - text;
+    if (numCols > 0 && text[numCols - 1] == '\r') numCols--;
+    if (numCols == 0) {
+        error("Terrain row has inconsistent number of columns");
+    }
+
+    costs.resize(numRows, numCols);
+    auto cell = costs.begin();
+    const char* row = text;
+    const char* end = text + length;
+    for (int r = 0; r < numRows; r++) {
+        const char* eol = static_cast<const char*>(memchr(row, '\n', end - row));
+        if (!eol) eol = end;
+        size_t width = eol - row;
+        if (width > 0 && row[width - 1] == '\r') width--;
+        if (width != numCols) {
+            error("Terrain row has inconsistent number of columns");
+        }
+        for (size_t c = 0; c < numCols; c++) {
+            int cost = costForChar(row[c]);
+            if (cost < 0) {
+                error("Terrain location has invalid character: '" + charToString(row[c]) + "'");
+            }
+            *cell = cost;
+            ++cell;
+        }
+        row = eol + 1;
+    }
+    if (!costs[0][0] || !costs[numRows - 1][numCols - 1]) {
+        error("Terrain entrance and exit must both be open");
+    }
+}
+
+void readTerrainFile(string filename, Grid<unsigned char>& costs) {
+    FileContents contents;
+    if (!contents.open(filename)) {
+        error("Cannot open file named " + filename);
+    }
+    parseTerrainText(contents.data(), contents.size(), costs);
+}
+
+void writeTerrainFile(string filename, const Grid<unsigned char>& costs) {
+    ofstream out(filename, ios::binary);
+    if (!out) error("Cannot open file named " + filename);
+    string line;
+    for (int r = 0; r < costs.numRows(); r++) {
+        line.clear();
+        for (int c = 0; c < costs.numCols(); c++) {
+            int cost = costs[r][c];
+            if (cost > kMaxTerrainCost) error("writeTerrainFile: cost " + integerToString(cost) + " is too large");
+            line += (cost == 0) ? '@' : (cost == 1) ? '-' : char('0' + cost);
+        }
+        line += '\n';
+        out.write(line.data(), line.size());
+    }
+    if (!out) error("Error writing terrain file " + filename);
+}
+
+void terrainFromMaze(const Grid<bool>& maze, Grid<unsigned char>& costs) {
+    costs.resize(maze.numRows(), maze.numCols());
+    auto cost = costs.begin();
+    for (bool open : maze) {
+        *cost = open ? 1 : 0;
+        ++cost;
+    }
+}
+
+bool solveTerrain(const Grid<unsigned char>& costs, Vector<GridLocation>& soln, long* totalCost) {
+    int numRows = costs.numRows();
+    int numCols = costs.numCols();
+    long numCells = long(numRows) * numCols;
+    if (numCells == 0) return false;
+    if (numCells >= (1L << 30)) {
+        error("solveTerrain: terrain is too large");
+    }
+
+    vector<unsigned char> state;
+    state.reserve(numCells);
+    for (unsigned char cost : costs) {
+        if (cost > kMaxTerrainCost) error("solveTerrain: cost " + integerToString(cost) + " is too large");
+        state.push_back(cost);
+    }
+    int exit = numCells - 1;
+    if (!state[0] || !state[exit]) return false;
+
+    const int numBuckets = kMaxTerrainCost + 1;
+    vector<vector<uint32_t>> buckets(numBuckets);
+    long numQueued = 0;
+
+    // Queues each open, unsettled neighbor of cell at cost + its own cost.
+    auto relax = [&](int cell, long cost) {
+        int row = cell / numCols;
+        int col = cell - row * numCols;
+        for (int dir = 0; dir < 4; dir++) {
+            int r = row + kRowStep[dir];
+            int c = col + kColStep[dir];
+            if (r < 0 || r >= numRows || c < 0 || c >= numCols) continue;
+            int next = r * numCols + c;
+            unsigned char s = state[next];
+            if (!(s & kCostBits) || (s & kSettled)) continue;
+            buckets[(cost + (s & kCostBits)) % numBuckets].push_back(uint32_t(next) << 2 | (3 - dir));
+            numQueued++;
+        }
+    };
+
+    state[0] |= kSettled;
+    long cost = 0;
+    bool found = (exit == 0);
+    if (!found) relax(0, 0);
+    while (!found && numQueued > 0) {
+        cost++;
+        // Every cost is at least 1, so nothing is added to this bucket while it is scanned.
+        vector<uint32_t>& bucket = buckets[cost % numBuckets];
+        for (size_t i = 0; i < bucket.size() && !found; i++) {
+            int cell = bucket[i] >> 2;
+            if (state[cell] & kSettled) continue;
+            state[cell] |= kSettled | (bucket[i] & 3) << kBackShift;
+            if (cell == exit) {
+                found = true;
+            } else {
+                relax(cell, cost);
+            }
+        }
+        numQueued -= bucket.size();
+        bucket.clear();
+    }
+    if (!found) return false;
+
+    vector<GridLocation> path;
+    for (int cell = exit; ; ) {
+        path.push_back({cell / numCols, cell % numCols});
+        if (cell == 0) break;
+        int back = (state[cell] >> kBackShift) & 3;
+        cell += kRowStep[back] * numCols + kColStep[back];
+    }
+    soln.clear();
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        soln.add(*it);
+    }
+    if (totalCost) *totalCost = cost;
+    return true;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Plain Dijkstra with a binary heap, returning the cheapest cost to the exit or -1. */
+static long referenceCheapestCost(const Grid<unsigned char>& costs) {
+    int numCols = costs.numCols();
+    long numCells = long(costs.numRows()) * numCols;
+    vector<long> best(numCells, -1);
+    typedef pair<long, int> Entry;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> queue;
+    best[0] = 0;
+    queue.push({0, 0});
+    while (!queue.empty()) {
+        Entry top = queue.top();
+        queue.pop();
+        if (top.first != best[top.second]) continue;
+        GridLocation loc = {top.second / numCols, top.second % numCols};
+        for (int dir = 0; dir < 4; dir++) {
+            GridLocation next = {loc.row + kRowStep[dir], loc.col + kColStep[dir]};
+            if (!costs.inBounds(next) || !costs[next]) continue;
+            int cell = next.row * numCols + next.col;
+            long cost = top.first + costs[next];
+            if (best[cell] < 0 || cost < best[cell]) {
+                best[cell] = cost;
+                queue.push({cost, cell});
+            }
+        }
+    }
+    return best[numCells - 1];
+}
+
+/* Fills costs with pseudo-random terrain: about 1 in 5 locations a wall, the rest cost 1-9. */
+static void makeSyntheticTerrain(Grid<unsigned char>& costs, int rows, int cols, unsigned seed) {
+    costs.resize(rows, cols);
+    uint64_t state = seed;
+    for (auto& cost : costs) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        unsigned bits = state >> 33;
+        cost = (bits % 5 == 0) ? 0 : 1 + (bits / 5) % kMaxTerrainCost;
+    }
+    // open the entrance and exit and their neighbors, so neither is walled in
+    costs[0][0] = costs[0][1] = costs[1][0] = 1;
+    costs[rows - 1][cols - 1] = costs[rows - 2][cols - 1] = costs[rows - 1][cols - 2] = 1;
+}
+
+STUDENT_TEST("parseTerrainText reads costs and rejects malformed terrain") {
+    string text = "-9@\r\n2-1\r\n";
+    Grid<unsigned char> costs;
+    parseTerrainText(text.data(), text.size(), costs);
+    Grid<unsigned char> expected = {{1, 9, 0}, {2, 1, 1}};
+    EXPECT_EQUAL(costs, expected);
+
+    for (string bad : {"", "--\n-", "-0\n--", "-x\n--", "@-\n--", "--\n\n--"}) {
+        EXPECT_ERROR(parseTerrainText(bad.data(), bad.size(), costs));
+    }
+
+    writeTerrainFile("res/_terrain.terrain", expected);
+    readTerrainFile("res/_terrain.terrain", costs);
+    EXPECT_EQUAL(costs, expected);
+    deleteFile("res/_terrain.terrain");
+
+    Grid<bool> maze;
+    readMazeFile("res/5x7.maze", maze);
+    Grid<unsigned char> fromMaze;
+    terrainFromMaze(maze, fromMaze);
+    readTerrainFile("res/5x7.maze", costs);   // every maze file is a terrain file
+    EXPECT_EQUAL(costs, fromMaze);
+}
+
+STUDENT_TEST("solveTerrain with every cost 1 returns exactly the solveMazeBFS path") {
+    for (string name : {"res/5x7.maze", "res/13x39.maze", "res/19x35.maze", "res/21x23.maze",
+                        "res/33x41.maze", "res/6x6.maze"}) {
+        Grid<bool> maze;
+        readMazeFile(name, maze);
+        Grid<unsigned char> costs;
+        terrainFromMaze(maze, costs);
+        Vector<GridLocation> expected, soln;
+        long cost = -1;
+        EXPECT_EQUAL(solveTerrain(costs, soln, &cost), solveMazeBFS(maze, expected));
+        if (!expected.isEmpty()) {
+            EXPECT_EQUAL(soln, expected);
+            EXPECT_EQUAL(cost, expected.size() - 1);
+        }
+    }
+    Grid<bool> open(7, 9, true);   // many equal-length paths
+    Grid<unsigned char> costs;
+    terrainFromMaze(open, costs);
+    Vector<GridLocation> expected, soln;
+    EXPECT(solveMazeBFS(open, expected));
+    EXPECT(solveTerrain(costs, soln));
+    EXPECT_EQUAL(soln, expected);
+}
+
+STUDENT_TEST("solveTerrain finds the cheapest path, not the shortest") {
+    Grid<unsigned char> costs = {{1, 9, 1},
+                                 {1, 0, 1},
+                                 {1, 1, 1}};
+    Vector<GridLocation> soln;
+    long cost = 0;
+    EXPECT(solveTerrain(costs, soln, &cost));
+    EXPECT_EQUAL(cost, 4);
+    EXPECT_EQUAL(soln, {{0, 0}, {1, 0}, {2, 0}, {2, 1}, {2, 2}});
+
+    for (unsigned seed = 1; seed <= 5; seed++) {
+        makeSyntheticTerrain(costs, 60, 80, seed);
+        bool solved = solveTerrain(costs, soln, &cost);
+        long expected = referenceCheapestCost(costs);
+        EXPECT_EQUAL(solved, expected >= 0);
+        if (solved) {
+            EXPECT_EQUAL(cost, expected);
+            long sum = 0;
+            for (int i = 1; i < soln.size(); i++) sum += costs[soln[i]];
+            EXPECT_EQUAL(sum, cost);
+        }
+    }
+}
+
+STUDENT_TEST("solveTerrain time on a 4000x4000 terrain (use 10000x10000 for the full-size run)") {
+    Grid<unsigned char> costs;
+    makeSyntheticTerrain(costs, 4000, 4000, 106);
+    Vector<GridLocation> soln;
+    long cost = 0;
+    TIME_OPERATION(costs.numRows() * costs.numCols(), solveTerrain(costs, soln, &cost));
+    EXPECT(!soln.isEmpty());
+    long expected = -1;
+    TIME_OPERATION(costs.numRows() * costs.numCols(), expected = referenceCheapestCost(costs));
+    EXPECT_EQUAL(cost, expected);
+}
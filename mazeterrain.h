@@ -0,0 +1,65 @@
+/*
+ * File: mazeterrain.h
+ * -------------------
+ * Defines weighted-terrain mazes, in which each open location has a cost
+ * to enter, and a cheapest-path solver for them.
+ *
+ * Terrain text format: one line per row, one character per location.
+ *     '@'        wall
+ *     '-', '1'   cost 1 (so every @/- maze file is also a terrain file)
+ *     '2'-'9'    cost 2 to 9
+ * A terrain is held as a Grid<unsigned char> of costs, 0 for a wall, which
+ * is one byte per location.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "grid.h"
+#include "vector.h"
+
+// The largest cost a location may have.
+const int kMaxTerrainCost = 9;
+
+/*
+ * The parseTerrainText function fills costs from the text of a terrain
+ * file, with either \n or \r\n line endings. Calls error() if the rows
+ * are ragged, a character is invalid, or the entrance and exit are not
+ * both open.
+ */
+void parseTerrainText(const char* text, size_t length, Grid<unsigned char>& costs);
+
+/*
+ * The readTerrainFile function reads a terrain file into costs. The file
+ * is memory-mapped and parsed in one pass, like readMazeFile.
+ */
+void readTerrainFile(std::string filename, Grid<unsigned char>& costs);
+
+/*
+ * The writeTerrainFile function writes costs in the terrain text format,
+ * using '-' for cost 1.
+ */
+void writeTerrainFile(std::string filename, const Grid<unsigned char>& costs);
+
+/*
+ * The terrainFromMaze function fills costs with the terrain in which every
+ * corridor of maze costs 1.
+ */
+void terrainFromMaze(const Grid<bool>& maze, Grid<unsigned char>& costs);
+
+/*
+ * The solveTerrain function finds a cheapest path from the entry (upper
+ * left) to the exit (lower right), where a path costs the sum of the
+ * costs of the locations it enters (not counting the entry). Stores the
+ * path in soln, and its cost in totalCost if that is not null, and returns
+ * true; or returns false if there is no path.
+ *
+ * It is Dial's algorithm: Dijkstra with a circular array of
+ * kMaxTerrainCost + 1 FIFO buckets in place of a heap. Neighbors are
+ * relaxed in generateValidMoves order (north, west, east, south), so when
+ * every cost is 1 the path is exactly the one solveMazeBFS returns.
+ * Besides costs it needs one byte per location plus the frontier, so a
+ * 10^8-location terrain solves in about 200MB.
+ */
+bool solveTerrain(const Grid<unsigned char>& costs, Vector<GridLocation>& soln, long* totalCost = nullptr);
@@ -0,0 +1,317 @@
+/*
+ * File: queryeval.cpp
+ * -------------------
+ * The compiled index and the cursors that evaluate queries over it. A
+ * query folds left to right just as in findQueryMatches: each term's
+ * cursor is joined to the cursor for everything before it by a union,
+ * an intersection (+) or a difference (-) cursor.
+ */
+#include <algorithm>
+#include <iostream>
+#include "error.h"
+#include "map.h"
+#include "queryeval.h"
+#include "search.h"
+#include "set.h"
+#include "strlib.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+const int DocCursor::kEnd;
+
+CompiledIndex::CompiledIndex(const Map<string, Set<string>>& index) {
+    Set<string> urls;
+    long numPostings = 0;
+    for (const string& term : index) {
+        const Set<string>& pages = index[term];
+        urls.unionWith(pages);
+        numPostings += pages.size();
+    }
+    unordered_map<string, int> docOf;
+    for (const string& url : urls) {
+        docOf[url] = _urls.size();
+        _urls.push_back(url);
+    }
+
+    // A Set iterates in sorted order, so each term's doc ids come out sorted.
+    _docs.reserve(numPostings);
+    _ranges.reserve(index.size());
+    for (const string& term : index) {
+        int start = _docs.size();
+        for (const string& url : index[term]) {
+            _docs.push_back(docOf[url]);
+        }
+        _ranges[term] = make_pair(start, int(_docs.size()));
+    }
+}
+
+bool CompiledIndex::postings(const string& term, const int*& begin, const int*& end) const {
+    auto found = _ranges.find(term);
+    if (found == _ranges.end()) return false;
+    begin = _docs.data() + found->second.first;
+    end = _docs.data() + found->second.second;
+    return true;
+}
+
+/* Walks one term's postings. advance gallops forward, then binary searches. */
+class TermCursor : public DocCursor {
+public:
+    TermCursor(const int* begin, const int* end) : _begin(begin), _pos(-1), _size(end - begin) {}
+
+    int next() override {
+        _pos++;
+        return _doc = _pos < _size ? _begin[_pos] : kEnd;
+    }
+
+    int advance(int target) override {
+        if (_doc >= target) return _doc;
+        // Everything up to _pos is below target; double the step until one is not.
+        long low = _pos + 1;
+        long step = 1;
+        while (low + step < _size && _begin[low + step] < target) {
+            low += step;
+            step *= 2;
+        }
+        long high = min(low + step + 1, _size);
+        _pos = lower_bound(_begin + low, _begin + high, target) - _begin;
+        return _doc = _pos < _size ? _begin[_pos] : kEnd;
+    }
+
+private:
+    const int* _begin;
+    long _pos;
+    long _size;
+};
+
+/* The documents of either child. */
+class UnionCursor : public DocCursor {
+public:
+    UnionCursor(unique_ptr<DocCursor> a, unique_ptr<DocCursor> b) : _a(move(a)), _b(move(b)) {}
+
+    int next() override {
+        // Both children start at -1 along with this cursor, so this also starts them.
+        if (_a->doc() == _doc) _a->next();
+        if (_b->doc() == _doc) _b->next();
+        return _doc = min(_a->doc(), _b->doc());
+    }
+
+    int advance(int target) override {
+        if (_doc >= target) return _doc;
+        if (_a->doc() < target) _a->advance(target);
+        if (_b->doc() < target) _b->advance(target);
+        return _doc = min(_a->doc(), _b->doc());
+    }
+
+private:
+    unique_ptr<DocCursor> _a, _b;
+};
+
+/* The documents of both children, found by leapfrogging one past the other. */
+class IntersectCursor : public DocCursor {
+public:
+    IntersectCursor(unique_ptr<DocCursor> a, unique_ptr<DocCursor> b) : _a(move(a)), _b(move(b)) {}
+
+    int next() override {
+        _a->next();
+        return align();
+    }
+
+    int advance(int target) override {
+        if (_doc >= target) return _doc;
+        _a->advance(target);
+        return align();
+    }
+
+private:
+    int align() {
+        int d = _a->doc();
+        while (d != kEnd) {
+            int e = _b->advance(d);
+            if (e == d) break;
+            d = _a->advance(e);
+        }
+        return _doc = d;
+    }
+
+    unique_ptr<DocCursor> _a, _b;
+};
+
+/* The documents of the first child that are not in the second. */
+class DifferenceCursor : public DocCursor {
+public:
+    DifferenceCursor(unique_ptr<DocCursor> a, unique_ptr<DocCursor> b) : _a(move(a)), _b(move(b)) {}
+
+    int next() override {
+        _a->next();
+        return skipExcluded();
+    }
+
+    int advance(int target) override {
+        if (_doc >= target) return _doc;
+        _a->advance(target);
+        return skipExcluded();
+    }
+
+private:
+    int skipExcluded() {
+        int d = _a->doc();
+        while (d != kEnd && _b->advance(d) == d) {
+            d = _a->next();
+        }
+        return _doc = d;
+    }
+
+    unique_ptr<DocCursor> _a, _b;
+};
+
+/* Returns the cursor for the pages containing every key of term. */
+static unique_ptr<DocCursor> termCursor(const CompiledIndex& index, const QueryTerm& term) {
+    unique_ptr<DocCursor> cursor;
+    for (const string& key : term.keys) {
+        const int* begin = nullptr;
+        const int* end = nullptr;
+        index.postings(key, begin, end);
+        unique_ptr<DocCursor> keyCursor(new TermCursor(begin, end));
+        if (cursor) {
+            cursor.reset(new IntersectCursor(move(cursor), move(keyCursor)));
+        } else {
+            cursor = move(keyCursor);
+        }
+    }
+    return cursor;
+}
+
+unique_ptr<DocCursor> compileQuery(const CompiledIndex& index, string query, const IndexOptions& options) {
+    unique_ptr<DocCursor> result;
+    for (const QueryTerm& term : parseQuery(query, options)) {
+        unique_ptr<DocCursor> cursor = termCursor(index, term);
+        if (!result) {
+            // Only a union can add pages to an empty result.
+            if (term.modifier == ' ') {
+                result = move(cursor);
+            } else {
+                result.reset(new TermCursor(nullptr, nullptr));
+            }
+        } else if (term.modifier == '+') {
+            result.reset(new IntersectCursor(move(result), move(cursor)));
+        } else if (term.modifier == '-') {
+            result.reset(new DifferenceCursor(move(result), move(cursor)));
+        } else {
+            result.reset(new UnionCursor(move(result), move(cursor)));
+        }
+    }
+    if (!result) result.reset(new TermCursor(nullptr, nullptr));
+    return result;
+}
+
+Vector<string> findQueryPage(const CompiledIndex& index, string query, int page, int pageSize,
+                             const IndexOptions& options) {
+    if (page < 0 || pageSize < 0) {
+        error("findQueryPage: page and pageSize must not be negative");
+    }
+    unique_ptr<DocCursor> cursor = compileQuery(index, query, options);
+    long skip = long(page) * pageSize;
+    for (long i = 0; i < skip && cursor->next() != DocCursor::kEnd; i++) {}
+    Vector<string> urls;
+    while (urls.size() < pageSize && cursor->next() != DocCursor::kEnd) {
+        urls.add(index.url(cursor->doc()));
+    }
+    return urls;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Pulls every match from the cursor for query, as a set of urls. */
+static Set<string> allMatches(const CompiledIndex& index, string query, const IndexOptions& options = IndexOptions()) {
+    Set<string> urls;
+    unique_ptr<DocCursor> cursor = compileQuery(index, query, options);
+    while (cursor->next() != DocCursor::kEnd) {
+        urls.add(index.url(cursor->doc()));
+    }
+    return urls;
+}
+
+STUDENT_TEST("compileQuery matches findQueryMatches on tiny.txt and website.txt") {
+    for (string dbfile : {"res/tiny.txt", "res/website.txt"}) {
+        Map<string, Set<string>> map;
+        buildIndex(dbfile, map);
+        CompiledIndex index(map);
+        EXPECT_EQUAL(index.numTerms(), map.size());
+        for (string query : {"red", "hippo", "red fish", "red +fish", "red -fish", "fish -red +eat",
+                             "citation", "style +grading", "cs106l template -qt", "the -the", "+qt",
+                             "-- the", "section +lecture -exam lair +the", ""}) {
+            EXPECT_EQUAL(allMatches(index, query), findQueryMatches(map, query));
+        }
+    }
+}
+
+STUDENT_TEST("compileQuery matches findQueryMatches with stemming and phrases") {
+    IndexOptions options;
+    options.removeStopWords = true;
+    options.stem = true;
+    options.ngramSize = 2;
+    Map<string, Set<string>> map;
+    buildIndex("res/website.txt", map, options);
+    CompiledIndex index(map);
+    for (string query : {"graded", "\"style guide\"", "assignments +\"due date\" -late",
+                         "\"the section leader will grade\""}) {
+        EXPECT_EQUAL(allMatches(index, query, options), findQueryMatches(map, query, options));
+    }
+}
+
+STUDENT_TEST("Cursor advance lands on the first match at or after the target") {
+    Map<string, Set<string>> map;
+    buildIndex("res/website.txt", map);
+    CompiledIndex index(map);
+    Vector<int> all;
+    unique_ptr<DocCursor> cursor = compileQuery(index, "section -exam");
+    while (cursor->next() != DocCursor::kEnd) all.add(cursor->doc());
+    EXPECT(all.size() > 2);
+    for (int i = 0; i < all.size(); i++) {
+        unique_ptr<DocCursor> fresh = compileQuery(index, "section -exam");
+        EXPECT_EQUAL(fresh->advance(i == 0 ? 0 : all[i - 1] + 1), all[i]);
+        EXPECT_EQUAL(fresh->advance(all[i]), all[i]);
+        if (i + 1 < all.size()) EXPECT_EQUAL(fresh->next(), all[i + 1]);
+    }
+    EXPECT_EQUAL(cursor->advance(0), DocCursor::kEnd);
+}
+
+STUDENT_TEST("findQueryPage returns consecutive pages of the sorted matches") {
+    Map<string, Set<string>> map;
+    buildIndex("res/website.txt", map);
+    CompiledIndex index(map);
+    Set<string> expected = findQueryMatches(map, "the");
+    Vector<string> joined;
+    for (int page = 0; ; page++) {
+        Vector<string> urls = findQueryPage(index, "the", page, 7);
+        joined += urls;
+        if (urls.size() < 7) break;
+    }
+    Vector<string> sorted;
+    for (const string& url : expected) sorted.add(url);
+    EXPECT_EQUAL(joined, sorted);
+    EXPECT(findQueryPage(index, "the", 1000, 10).isEmpty());
+    EXPECT_ERROR(findQueryPage(index, "the", -1, 10));
+}
+
+STUDENT_TEST("First page of results vs the whole result set") {
+    // A synthetic collection large enough for the difference to show.
+    Map<string, Set<string>> map;
+    for (int page = 0; page < 200000; page++) {
+        string url = "https://example.com/" + integerToString(1000000 + page);
+        map["common"].add(url);
+        if (page % 2 == 0) map["even"].add(url);
+        if (page % 7 == 0) map["seven"].add(url);
+    }
+    CompiledIndex index(map);
+    Set<string> everything;
+    Vector<string> first;
+    TIME_OPERATION(index.numDocs(), everything = findQueryMatches(map, "common +even -seven"));
+    TIME_OPERATION(10, first = findQueryPage(index, "common +even -seven", 0, 10));
+    TIME_OPERATION(10, first = findQueryPage(index, "common +even -seven", 1000, 10));
+    EXPECT_EQUAL(first.size(), 10);
+    EXPECT(everything.contains(first[0]));
+}
@@ -0,0 +1,100 @@
+/*
+ * File: queryeval.h
+ * -----------------
+ * Defines document-at-a-time query evaluation. The inverted index is
+ * compiled into sorted arrays of integer document ids, and a query is
+ * turned into a tree of cursors that walk those arrays in step. Matches
+ * come out one at a time in url order, so asking for the first page of
+ * results only does the work for that page.
+ */
+
+#pragma once
+
+#include <climits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "map.h"
+#include "search.h"
+#include "set.h"
+#include "vector.h"
+
+/*
+ * A CompiledIndex holds the same information as the Map built by
+ * buildIndex. Documents are numbered in url order, and each term's
+ * postings are its documents' numbers in increasing order, all stored in
+ * one array.
+ */
+class CompiledIndex {
+public:
+    CompiledIndex(const Map<std::string, Set<std::string>>& index);
+
+    int numDocs() const {
+        return _urls.size();
+    }
+
+    int numTerms() const {
+        return _ranges.size();
+    }
+
+    const std::string& url(int doc) const {
+        return _urls[doc];
+    }
+
+    /*
+     * Sets begin and end to the postings of term and returns true, or
+     * returns false if the term is not in the index.
+     */
+    bool postings(const std::string& term, const int*& begin, const int*& end) const;
+
+private:
+    std::vector<std::string> _urls;
+    std::vector<int> _docs;
+    std::unordered_map<std::string, std::pair<int, int>> _ranges;   // term -> [start, end) in _docs
+};
+
+/*
+ * A DocCursor walks the documents matching some part of a query, in
+ * increasing order. It starts before the first document; doc() is -1
+ * until next() or advance() is called, and kEnd once it is used up.
+ */
+class DocCursor {
+public:
+    static const int kEnd = INT_MAX;
+
+    virtual ~DocCursor() {}
+
+    int doc() const {
+        return _doc;
+    }
+
+    /* Moves to the next matching document and returns it, or kEnd. */
+    virtual int next() = 0;
+
+    /*
+     * Moves to the first matching document at or after target and
+     * returns it, or kEnd. Does not move if already there.
+     */
+    virtual int advance(int target) = 0;
+
+protected:
+    int _doc = -1;
+};
+
+/*
+ * The compileQuery function parses query with parseQuery and returns the
+ * cursor for its matches in index. The result is the same set of pages
+ * findQueryMatches gives for the same query and options.
+ */
+std::unique_ptr<DocCursor> compileQuery(const CompiledIndex& index, std::string query,
+                                        const IndexOptions& options = IndexOptions());
+
+/*
+ * The findQueryPage function returns the urls of matches number
+ * page * pageSize through (page + 1) * pageSize - 1 of query, counting
+ * from 0 in url order. Only the matches up to the end of that page are
+ * ever computed.
+ */
+Vector<std::string> findQueryPage(const CompiledIndex& index, std::string query, int page, int pageSize,
+                                  const IndexOptions& options = IndexOptions());
@@ -10,13 +10,18 @@
 
 #include <iostream>
 #include <fstream>
+#include "autocomplete.h"
+#include "docstore.h"
 #include "error.h"
 #include "filelib.h"
 #include "map.h"
+#include "queryeval.h"
 #include "search.h"
 #include "set.h"
+#include "simhash.h"
 #include "simpio.h"
 #include "strlib.h"
+#include "tokenpipeline.h"
 #include "vector.h"
 #include "SimpleTest.h"
 using namespace std;
@@ -56,16 +61,42 @@ string cleanToken(string s)
  * letter characters
  */
 Set<string> gatherTokens(string text) {
-    Vector<string> tokenized = stringSplit(text, " ");
+    return gatherTokens(text, IndexOptions());
+}
+
+/*
+ * Builds the TokenPipeline that applies the analysis stages selected
+ * by options.
+ */
+static TokenPipeline makePipeline(const IndexOptions& options)
+{
+    return TokenPipeline(options.removeStopWords, options.stem, options.ngramSize);
+}
+
+/*
+ * Runs text through pipeline and adds each resulting term to tokens.
+ * The pipeline reuses its buffers, so the only allocations are the
+ * strings of terms that are new to tokens.
+ */
+static void addTokens(TokenPipeline& pipeline, const string& text, Set<string>& tokens)
+{
+    pipeline.run(text.data(), text.size(), [&](TokenView term) {
+        tokens.add(term.toString());
+    });
+}
+
+/*
+ * This version of gatherTokens also applies the analysis stages
+ * selected in options: stop-word removal, stemming and n-grams.
+ * @param text is the string of words to turn into tokens
+ * @param options selects the analysis stages
+ * @return the set of analyzed terms
+ */
+Set<string> gatherTokens(string text, const IndexOptions& options)
+{
+    TokenPipeline pipeline = makePipeline(options);
     Set<string> tokens;
-    for(auto token : tokenized)
-    {
-        string newToken = cleanToken(token);
-        if(!newToken.empty())
-        {
-            tokens.add(newToken);
-        }
-    }
+    addTokens(pipeline, text, tokens);
     return tokens;
 }
 
@@ -81,6 +112,41 @@ Set<string> gatherTokens(string text) {
  * @return the number of indexes processes and stored into index argument
  */
 int buildIndex(string dbfile, Map<string, Set<string>>& index) {
+    return buildIndex(dbfile, index, IndexOptions());
+}
+
+/*
+ * This version of buildIndex analyzes each page with the stages
+ * selected in options. One pipeline is shared by every page. If
+ * options names a doc store file, the page bodies are written there.
+ * @param dbfile is the database that will be read
+ * @param index is the inverted index that will be filled
+ * @param options selects the analysis stages
+ * @return the number of pages processed
+ */
+int buildIndex(string dbfile, Map<string, Set<string>>& index, const IndexOptions& options)
+{
+    Map<string, Set<string>> aliases;
+    return buildIndex(dbfile, index, options, aliases);
+}
+
+/*
+ * This version of buildIndex also reports near-duplicate pages. When
+ * options.removeNearDuplicates is set, pages whose SimHash signatures
+ * differ in at most options.duplicateDistance bits are grouped, and only
+ * the first page of each group in url order is indexed.
+ * @param dbfile is the database that will be read
+ * @param index is the inverted index that will be filled
+ * @param options selects the analysis stages and deduplication
+ * @param aliases is filled with each indexed page's near-duplicates
+ * @return the number of pages processed, duplicates included
+ */
+int buildIndex(string dbfile, Map<string, Set<string>>& index, const IndexOptions& options,
+               Map<string, Set<string>>& aliases)
+{
+    aliases.clear();
+    TokenPipeline pipeline = makePipeline(options);
+
     // Open the database file
     ifstream file(dbfile);
     if(!file.is_open())
@@ -91,6 +157,8 @@ int buildIndex(string dbfile, Map<string, Set<string>>& index) {
 
     // Read and process each line in the database file
     Map<string, Set<string>> indexPair;
+    Map<string, string> bodies;   // only kept when writing a doc store
+    bool storeBodies = !options.docStoreFile.empty();
     string url;
     string line;
 
@@ -102,12 +170,44 @@ int buildIndex(string dbfile, Map<string, Set<string>>& index) {
         }
         else
         {
-            Set<string> tokens = gatherTokens(line);
+            Set<string> tokens;
+            addTokens(pipeline, line, tokens);
             indexPair[url] = tokens;
+            if(storeBodies)
+            {
+                bodies[url] = line;
+            }
             url.clear();
         }
     }
     file.close();
+    if(storeBodies)
+    {
+        writeDocStore(options.docStoreFile, bodies);
+    }
+    int numPages = indexPair.size();
+
+    // Collapse each group of near-duplicates onto its first page
+    if(options.removeNearDuplicates)
+    {
+        Vector<string> urls;
+        Vector<uint64_t> signatures;
+        for(const string& pageUrl : indexPair)
+        {
+            urls.add(pageUrl);
+            signatures.add(simHash(indexPair[pageUrl]));
+        }
+        Vector<int> canonical;
+        findNearDuplicates(signatures, options.duplicateDistance, canonical);
+        for(int i = 0; i < urls.size(); i++)
+        {
+            if(canonical[i] != i)
+            {
+                aliases[urls[canonical[i]]].add(urls[i]);
+                indexPair.remove(urls[i]);
+            }
+        }
+    }
 
     // Update the inverted index for each token
     for(auto i: indexPair)
@@ -121,7 +221,7 @@ int buildIndex(string dbfile, Map<string, Set<string>>& index) {
         }
     }
 
-    return indexPair.size();
+    return numPages;
 }
 
 /*
@@ -138,39 +238,130 @@ int buildIndex(string dbfile, Map<string, Set<string>>& index) {
  */
 Set<string> findQueryMatches(Map<string, Set<string>>& index, string query)
 {
-    Set<string> result;
-    Vector<string> searchTerms = stringSplit(query, " ");
-    string firstTerm = cleanToken(searchTerms[0]);
-    if(index.get(firstTerm) != index.get(index.lastKey()))
+    return findQueryMatches(index, query, IndexOptions());
+}
+
+/*
+ * Analyzes the words of one query term, a single word or a quoted phrase,
+ * into the index keys a page must contain to match it. A phrase of up to
+ * ngramSize terms is one n-gram key; a longer one needs all of its
+ * ngramSize-word windows. The keys are empty if the words analyze to
+ * nothing (punctuation or stop words only).
+ * @param pipeline analyzes the words the same way the index was built
+ * @param words are the words of the term
+ * @param keys is filled with the index keys of the term
+ */
+static void termKeys(TokenPipeline& pipeline, const Vector<string>& words, Vector<string>& keys)
+{
+    int n = pipeline.ngramSize();
+    int count = 0;
+    TokenView term;
+    pipeline.resetNgrams();
+    for (const string& word : words)
+    {
+        if (!pipeline.analyzeWord(word.data(), word.size(), term))
+        {
+            continue;
+        }
+        count++;
+        if (count >= n && pipeline.ngram(n, term))
+        {
+            keys.add(term.toString());
+        }
+    }
+    if (count > 0 && count < n)
     {
-        result = index[firstTerm];
+        // Shorter than a window: the whole phrase is one key
+        if (count > 1) pipeline.ngram(count, term);
+        keys.add(term.toString());
     }
+}
+
+/*
+ * The parseQuery function splits query into its terms. Every term after
+ * the first may have a '+' or '-' modifier, and with ngramSize > 1 a term
+ * may be a quoted phrase, e.g. +"red fish". Each term is analyzed with
+ * the stages in options; terms that analyze to nothing, such as stop
+ * words, are left out. The first term kept becomes the leading term and
+ * loses any modifier, so "the +grading" means "grading".
+ * @param query is the inputed search made by the user
+ * @param options selects the analysis stages
+ * @return the terms of the query, in order
+ */
+Vector<QueryTerm> parseQuery(string query, const IndexOptions& options)
+{
+    TokenPipeline pipeline = makePipeline(options);
+    Vector<QueryTerm> terms;
+    Vector<string> searchTerms = stringSplit(query, " ");
 
-    for(int i = 1; i < searchTerms.size(); i++)
+    for (int i = 0; i < searchTerms.size(); i++)
     {
-        char modifier = searchTerms[i][0];
-        string term = cleanToken(searchTerms[i].substr(1));
+        string word = searchTerms[i];
+        QueryTerm term;
+        term.modifier = ' ';
+        if (i > 0 && (startsWith(word, "+") || startsWith(word, "-")))
+        {
+            term.modifier = word[0];
+            word = word.substr(1);
+        }
 
-        if(index.get(term) != index.get(index.lastKey()))
+        // Gather the words of a quoted phrase, or just this one word
+        Vector<string> words = {word};
+        if (options.ngramSize > 1 && startsWith(word, "\"") && !(word.size() > 1 && endsWith(word, "\"")))
         {
-            if(modifier == '+')
+            while (i + 1 < searchTerms.size() && !endsWith(words[words.size() - 1], "\""))
             {
-                // Intersect w/ the matches for term
-                Set<string> termSet = index[term];
-                result.intersect(termSet);
+                words.add(searchTerms[++i]);
             }
-            else if(modifier == '-')
-            {
-                // Removes the matches for this term from the current search
-                Set<string> termSet = index[term];
-                result.difference(termSet);
-            }
-            else
+        }
+
+        termKeys(pipeline, words, term.keys);
+        if (!term.keys.isEmpty())
+        {
+            if (terms.isEmpty())
             {
-                // Union w/ the matches for the term
-                Set<string> termSet = index[modifier + term];
-                result.unionWith(termSet);
+                term.modifier = ' ';
             }
+            terms.add(term);
+        }
+    }
+    return terms;
+}
+
+/*
+ * This version of findQueryMatches analyzes each query term with the
+ * stages in options, which must be the options the index was built
+ * with (see parseQuery).
+ * @param index is the inverted index to search
+ * @param query is the inputed search made by the user
+ * @param options selects the analysis stages
+ * @return a set of urls that match the query
+ */
+Set<string> findQueryMatches(Map<string, Set<string>>& index, string query, const IndexOptions& options)
+{
+    Set<string> result;
+    for (const QueryTerm& term : parseQuery(query, options))
+    {
+        Set<string> termSet = index.get(term.keys[0]);
+        for (int i = 1; i < term.keys.size(); i++)
+        {
+            termSet.intersect(index.get(term.keys[i]));
+        }
+
+        if (term.modifier == '+')
+        {
+            // Intersect w/ the matches for term
+            result.intersect(termSet);
+        }
+        else if (term.modifier == '-')
+        {
+            // Removes the matches for this term from the current search
+            result.difference(termSet);
+        }
+        else
+        {
+            // Union w/ the matches for the term
+            result.unionWith(termSet);
         }
     }
     return result;
@@ -185,35 +376,126 @@ Set<string> findQueryMatches(Map<string, Set<string>>& index, string query)
  * @return void
  */
 void searchEngine(string dbfile) {
+    searchEngine(dbfile, IndexOptions());
+}
+
+/*
+ * This version of searchEngine builds the index and answers the
+ * queries with the analysis stages selected in options. Entering
+ * ?prefix lists the most common index terms starting with prefix,
+ * weighted up by the queries in options.queryLogFile and this session.
+ * Matches are shown ten at a time; entering n shows the next ten, and
+ * RETURN/ENTER quits as always.
+ * @param dbfile contains all the url and index tokens used in the search engine
+ * @param options selects the analysis stages and the query log
+ * @return void
+ */
+void searchEngine(string dbfile, const IndexOptions& options)
+{
     // Create the inverted index
     Map<string, Set<string>> index;
-    int pageNum = buildIndex(dbfile, index);
+    int pageNum = buildIndex(dbfile, index, options);
 
     // Print info about the index
     cout << "Processed " << pageNum << " pages containing " << index.size() << " unique terms." << endl;
     cout << endl;
 
+    // Queries are answered a page at a time from the compiled index
+    const int kPageSize = 10;
+    CompiledIndex compiled(index);
+    unique_ptr<DocStore> store;
+    if(!options.docStoreFile.empty())
+    {
+        store.reset(new DocStore(options.docStoreFile));
+    }
+    string lastQuery;
+    unique_ptr<DocCursor> cursor;
+    int shown = 0;
+
+    // Completions come from the term dictionary, weighted by past queries
+    Autocompleter completer;
+    completer.build(index);
+    if(!options.queryLogFile.empty() && fileExists(options.queryLogFile))
+    {
+        ifstream log(options.queryLogFile);
+        Vector<string> pastQueries;
+        for(string line; getline(log, line); )
+        {
+            pastQueries.add(line);
+        }
+        completer.replayQueryLog(pastQueries, options);
+    }
+
     //Enter a loop for user inputs
     while(true)
     {
-        // Prompt user
+        // Prompt user; while a query has more matches, n shows them
         string query;
-        cout << "Enter query sentence (RETURN/ENTER to quit): ";
+        if (cursor)
+        {
+            cout << "Enter query sentence (n for more matches, RETURN/ENTER to quit): ";
+        }
+        else
+        {
+            cout << "Enter query sentence (RETURN/ENTER to quit): ";
+        }
         getline(cin, query);
 
         if(query.empty())
         {
             break;
         }
+        if(startsWith(query, "?"))
+        {
+            Vector<string> completions = completer.complete(toLowerCase(trim(query.substr(1))));
+            cout << (completions.isEmpty() ? "No completions" : stringJoin(completions, "  ")) << endl << endl;
+            continue;
+        }
+        if(!(cursor && query == "n"))
+        {
+            completer.replayQueryLog({query}, options);
+            if(!options.queryLogFile.empty())
+            {
+                ofstream log(options.queryLogFile, ios::app);
+                log << query << endl;
+            }
+            cursor = compileQuery(compiled, query, options);
+            cursor->next();
+            lastQuery = query;
+            shown = 0;
+        }
 
-        // Find and print matching pages for the query
-        Set<string> match = findQueryMatches(index, query);
-
-        // Print matching URLs
-        cout << "Found " << match.size() << " matching pages" << endl;
-        for(auto url : match)
+        // Take the next page of matching URLs; the cursor stays one match ahead,
+        // so we know whether more follow before printing the page
+        Vector<string> page;
+        for(int i = 0; i < kPageSize && cursor->doc() != DocCursor::kEnd; i++)
+        {
+            page.add(compiled.url(cursor->doc()));
+            cursor->next();
+        }
+        bool more = cursor->doc() != DocCursor::kEnd;
+        if(shown == 0 && !more)
+        {
+            cout << "Found " << page.size() << " matching pages" << endl;
+        }
+        else
+        {
+            cout << "Showing matches " << shown + 1 << "-" << shown + page.size();
+            cout << (more ? " (more follow)" : " of " + integerToString(shown + page.size())) << endl;
+        }
+        for(const string& url : page)
         {
             cout << url << endl;
+            if(store)
+            {
+                // The store numbers its documents differently, so look the page up by url
+                cout << "    " << store->snippet(store->findUrl(url), lastQuery, options) << endl;
+            }
+        }
+        shown += page.size();
+        if(!more)
+        {
+            cursor.reset();
         }
         cout << endl;
     }
@@ -265,6 +547,109 @@ STUDENT_TEST("findQueryMatches tests operators")
 }
 
 
+STUDENT_TEST("gatherTokens and buildIndex with stop words removed and stemming")
+{
+    IndexOptions options;
+    options.removeStopWords = true;
+    options.stem = true;
+    Set<string> expected = {"cat", "hat", "run"};
+    EXPECT_EQUAL(gatherTokens("The Cats and the HATS are running", options), expected);
+
+    Map<string, Set<string>> index;
+    EXPECT_EQUAL(buildIndex("res/website.txt", index, options), buildIndex("res/website.txt", index));
+    index.clear();
+    buildIndex("res/website.txt", index, options);
+    EXPECT(!index.containsKey("the"));
+    EXPECT(index.containsKey("grade"));
+    EXPECT(!index.containsKey("grading"));
+}
+
+STUDENT_TEST("findQueryMatches analyzes query terms the same way as the index")
+{
+    Map<string, Set<string>> plain, analyzed;
+    buildIndex("res/website.txt", plain);
+    IndexOptions options;
+    options.removeStopWords = true;
+    options.stem = true;
+    buildIndex("res/website.txt", analyzed, options);
+
+    Set<string> stemmed = findQueryMatches(analyzed, "grading", options);
+    EXPECT_EQUAL(findQueryMatches(analyzed, "GRADED", options), stemmed);
+    EXPECT(findQueryMatches(plain, "grading").isSubsetOf(stemmed));
+    EXPECT(findQueryMatches(plain, "graded").isSubsetOf(stemmed));
+
+    // Stop words are ignored rather than matching nothing
+    EXPECT_EQUAL(findQueryMatches(analyzed, "the grading", options), stemmed);
+    EXPECT_EQUAL(findQueryMatches(analyzed, "grading +the -of", options), stemmed);
+    EXPECT_EQUAL(findQueryMatches(analyzed, "the +grading", options), stemmed);
+    EXPECT_EQUAL(findQueryMatches(analyzed, "of -grading", options), stemmed);
+}
+
+STUDENT_TEST("findQueryMatches no longer has the quirks of the original version")
+{
+    Map<string, Set<string>> index;
+    buildIndex("res/website.txt", index);
+
+    // Later terms are cleaned whole; the original looked up the raw first
+    // character plus the cleaned rest, so "Grading" found nothing
+    EXPECT_EQUAL(findQueryMatches(index, "citation Grading"), findQueryMatches(index, "citation grading"));
+    EXPECT(findQueryMatches(index, "citation Grading").size() > findQueryMatches(index, "citation").size());
+
+    // The last term in the index is not skipped; the original ignored any
+    // term whose pages were the same as the last term's
+    string last = index.lastKey();
+    EXPECT(!index[last].isEmpty());
+    EXPECT_EQUAL(findQueryMatches(index, last), index[last]);
+
+    // Searching never adds terms to the index
+    int numTerms = index.size();
+    findQueryMatches(index, "xqzzy +qxzzy -zzqxy");
+    EXPECT_EQUAL(index.size(), numTerms);
+    EXPECT(!index.containsKey("qxzzy"));
+}
+
+STUDENT_TEST("findQueryMatches with bigrams and quoted phrases on tiny.txt")
+{
+    IndexOptions options;
+    options.ngramSize = 2;
+    Map<string, Set<string>> index;
+    buildIndex("res/tiny.txt", index, options);
+    EXPECT(index.containsKey("red fish"));
+    EXPECT(index.containsKey("two fish"));
+    EXPECT_EQUAL(findQueryMatches(index, "\"red fish\"", options), {"www.dr.seuss.net"});
+    EXPECT_EQUAL(findQueryMatches(index, "\"eat fish\"", options), {"www.bigbadwolf.com"});
+    EXPECT_EQUAL(findQueryMatches(index, "fish -\"eat fish\"", options).size(), 2);
+    EXPECT_EQUAL(findQueryMatches(index, "\"one fish two fish\"", options), {"www.dr.seuss.net"});
+    EXPECT(findQueryMatches(index, "\"fish red blue\"", options).isEmpty());
+    EXPECT_EQUAL(findQueryMatches(index, "red fish", options), findQueryMatches(index, "red fish"));
+}
+
+STUDENT_TEST("Index size and build time with the analysis stages on and off")
+{
+    // plain, stop words, stop words + stem, stop words + stem + bigrams
+    Vector<int> sizes;
+    Vector<long> totals;
+    for (int config = 0; config < 4; config++)
+    {
+        IndexOptions options;
+        options.removeStopWords = config >= 1;
+        options.stem = config >= 2;
+        options.ngramSize = config >= 3 ? 2 : 1;
+        Map<string, Set<string>> index;
+        TIME_OPERATION(config, buildIndex("res/website.txt", index, options));
+        long postings = 0;
+        for (const string& term : index)
+        {
+            postings += index[term].size();
+        }
+        sizes.add(index.size());
+        totals.add(postings);
+    }
+    EXPECT(sizes[1] < sizes[0] && totals[1] < totals[0]);
+    EXPECT(sizes[2] < sizes[1] && totals[2] < totals[1]);
+    EXPECT(sizes[3] > sizes[2] && totals[3] > totals[2]);
+}
+
 PROVIDED_TEST("gatherTokens from seuss, 6 unique tokens, mixed case, punctuation") {
     Set<string> tokens = gatherTokens("One Fish Two Fish *Red* fish Blue fish ** 10 RED Fish?");
     EXPECT_EQUAL(tokens.size(), 6);
@@ -2,16 +2,52 @@
 
 #include "map.h"
 #include "set.h"
+#include "vector.h"
 #include <string>
 
+/*
+ * IndexOptions selects the analysis stages applied to page text when an
+ * index is built (see tokenpipeline.h). Queries against that index must be
+ * run with the same options so their terms are analyzed the same way.
+ * The defaults give the plain cleanToken terms.
+ */
+struct IndexOptions {
+    bool removeStopWords = false;   // drop "the", "and", "of", ...
+    bool stem = false;              // Porter-stem every term
+    int ngramSize = 1;              // also index word n-grams up to this size
+    std::string docStoreFile;       // if not empty, buildIndex also writes a doc store here
+    bool removeNearDuplicates = false;  // index one canonical page per group of near-duplicates
+    int duplicateDistance = 3;          // SimHash bits in which near-duplicates may differ
+    std::string queryLogFile;       // if not empty, searchEngine replays and appends its queries here
+};
+
+/*
+ * One term of a parsed query. A page matches the term if it contains
+ * every one of keys (more than one only for a phrase longer than the
+ * n-gram size). modifier is '+' (intersect), '-' (subtract) or ' ' (union).
+ */
+struct QueryTerm {
+    char modifier;
+    Vector<std::string> keys;
+};
+
 // Prototypes to be shared with other modules
 
 std::string cleanToken(std::string token);
 
 Set<std::string> gatherTokens(std::string bodyText);
+Set<std::string> gatherTokens(std::string bodyText, const IndexOptions& options);
 
 int buildIndex(std::string dbfile, Map<std::string, Set<std::string>>& index);
+int buildIndex(std::string dbfile, Map<std::string, Set<std::string>>& index, const IndexOptions& options);
+int buildIndex(std::string dbfile, Map<std::string, Set<std::string>>& index, const IndexOptions& options,
+               Map<std::string, Set<std::string>>& aliases);
+
+Vector<QueryTerm> parseQuery(std::string query, const IndexOptions& options);
 
 Set<std::string> findQueryMatches(Map<std::string, Set<std::string>>& index, std::string query);
+Set<std::string> findQueryMatches(Map<std::string, Set<std::string>>& index, std::string query,
+                                  const IndexOptions& options);
 
 void searchEngine(std::string dbfile);
+void searchEngine(std::string dbfile, const IndexOptions& options);
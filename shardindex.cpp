@@ -0,0 +1,651 @@
+/*
+ * File: shardindex.cpp
+ * --------------------
+ * Shard building and the scatter-gather coordinator. Each worker talks to
+ * the coordinator over its own Unix socket with a line protocol:
+ *     request   "<id>\t<limit>\t<query>\n"      limit -1 means all matches
+ *     response  "<id>\t<count>\n" then count lines, one url each
+ * A worker announces it has loaded its shard with the response "0\t0\n".
+ * Query ids start at 1 and only increase, so a late answer to an earlier
+ * query is recognized by its id and dropped.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#include "error.h"
+#include "filelib.h"
+#include "map.h"
+#include "queryeval.h"
+#include "search.h"
+#include "set.h"
+#include "shardindex.h"
+#include "strlib.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+static const int kSendFlags = MSG_NOSIGNAL;
+#else
+static const int kSendFlags = 0;   // sockets are set SO_NOSIGPIPE, or SIGPIPE is ignored instead
+#endif
+#endif
+
+
+int shardOf(const string& url, int numShards) {
+    uint32_t h = 2166136261u;   // FNV-1a, so the split is the same on every run
+    for (char ch : url) {
+        h = (h ^ (unsigned char) ch) * 16777619u;
+    }
+    return h % numShards;
+}
+
+string shardFileName(const string& prefix, int shard) {
+    return prefix + "-" + integerToString(shard) + ".idx";
+}
+
+void writeShardFile(string filename, const Map<string, Set<string>>& index) {
+    ofstream out(filename);
+    if (!out) {
+        error("Cannot write shard file " + filename);
+    }
+    for (const string& term : index) {
+        out << term;
+        for (const string& url : index[term]) {
+            out << '\t' << url;
+        }
+        out << '\n';
+    }
+    if (!out) {
+        error("Cannot write shard file " + filename);
+    }
+}
+
+/*
+ * Fills index from the text of a shard file, returning false if a line
+ * has no pages. Uses only string operations, so a worker process can call
+ * it (see ShardCluster::ShardCluster).
+ */
+static bool parseShardText(const string& text, Map<string, Set<string>>& index) {
+    index.clear();
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == string::npos) end = text.size();
+        size_t tab = text.find('\t', start);
+        if (tab == string::npos || tab > end) return false;
+        Set<string>& pages = index[text.substr(start, tab - start)];
+        while (tab < end) {
+            size_t next = min(text.find('\t', tab + 1), end);
+            pages.add(text.substr(tab + 1, next - tab - 1));
+            tab = next;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+void readShardFile(string filename, Map<string, Set<string>>& index) {
+    ifstream in(filename);
+    if (!in) {
+        error("Cannot read shard file " + filename);
+    }
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (!parseShardText(text, index)) {
+        error("Shard file " + filename + " has a term with no pages");
+    }
+}
+
+int buildShardedIndex(string dbfile, int numShards, string prefix, const IndexOptions& options) {
+    if (numShards < 1) {
+        error("buildShardedIndex: need at least one shard");
+    }
+    int numPages = 0;
+    for (int shard = 0; shard < numShards; shard++) {
+        ifstream file(dbfile);
+        if (!file) {
+            error("Cannot read database file " + dbfile);
+        }
+        Map<string, Set<string>> index;
+        string url;
+        string line;
+        numPages = 0;
+        while (getline(file, line)) {
+            if (url.empty()) {
+                url = line;
+                continue;
+            }
+            if (shardOf(url, numShards) == shard) {
+                for (const string& term : gatherTokens(line, options)) {
+                    index[term].add(url);
+                }
+            }
+            numPages++;
+            url.clear();
+        }
+        writeShardFile(shardFileName(prefix, shard), index);
+    }
+    return numPages;
+}
+
+/*
+ * Removes one complete response from the front of pending, storing its
+ * query id and urls, and returns true; or returns false and leaves
+ * pending alone if it does not yet hold a whole response.
+ */
+static bool takeResponse(string& pending, long& id, Vector<string>& urls) {
+    size_t headerEnd = pending.find('\n');
+    if (headerEnd == string::npos) return false;
+    size_t tab = pending.find('\t');
+    if (tab == string::npos || tab > headerEnd) {
+        error("ShardCluster: malformed response from a worker");
+    }
+    long count = stringToInteger(pending.substr(tab + 1, headerEnd - tab - 1));
+
+    // Find where the count url lines end before copying any of them.
+    size_t end = headerEnd;
+    for (long i = 0; i < count; i++) {
+        end = pending.find('\n', end + 1);
+        if (end == string::npos) return false;
+    }
+    id = stringToInteger(pending.substr(0, tab));
+    urls.clear();
+    for (size_t start = headerEnd + 1; start <= end; ) {
+        size_t newline = pending.find('\n', start);
+        urls.add(pending.substr(start, newline - start));
+        start = newline + 1;
+    }
+    pending.erase(0, end + 1);
+    return true;
+}
+
+#ifndef _WIN32
+
+/* Writes all of data to fd, returning false if the other end has gone. */
+static bool sendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, kSendFlags);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+/* Reads the whole of filename into text with system calls alone, returning false if it cannot be read. */
+static bool readWholeFile(const string& filename, string& text) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    char buffer[65536];
+    while (true) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            close(fd);
+            return false;
+        }
+        if (n == 0) break;
+        text.append(buffer, n);
+    }
+    close(fd);
+    return true;
+}
+
+/* Appends the decimal digits of n to out, without the locale-aware stream formatting. */
+static void appendNumber(string& out, long n) {
+    char digits[24];
+    int length = 0;
+    unsigned long value = n < 0 ? 0 - (unsigned long) n : n;
+    do {
+        digits[length++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    if (n < 0) out += '-';
+    while (length > 0) out += digits[--length];
+}
+
+/*
+ * The body of a worker process: loads one shard and answers requests
+ * on fd until the coordinator closes its end. Returns false if the shard
+ * cannot be loaded.
+ */
+static bool serveShard(int fd, const string& filename, const IndexOptions& options) {
+    unique_ptr<CompiledIndex> compiled;
+    {
+        string text;
+        Map<string, Set<string>> index;
+        if (!readWholeFile(filename, text) || !parseShardText(text, index)) return false;
+        compiled.reset(new CompiledIndex(index));
+    }
+    if (!sendAll(fd, "0\t0\n")) return true;
+
+    string pending;
+    char buffer[4096];
+    while (true) {
+        size_t newline;
+        while ((newline = pending.find('\n')) != string::npos) {
+            string request = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            size_t tab1 = request.find('\t');
+            size_t tab2 = request.find('\t', tab1 + 1);
+            string id = request.substr(0, tab1);
+            long limit = strtol(request.c_str() + tab1 + 1, nullptr, 10);
+            string query = request.substr(tab2 + 1);
+
+            string body;
+            long count = 0;
+            unique_ptr<DocCursor> cursor = compileQuery(*compiled, query, options);
+            while ((limit < 0 || count < limit) && cursor->next() != DocCursor::kEnd) {
+                body += compiled->url(cursor->doc());
+                body += '\n';
+                count++;
+            }
+            string response = id + "\t";
+            appendNumber(response, count);
+            response += '\n';
+            if (!sendAll(fd, response + body)) return true;
+        }
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return true;
+        pending.append(buffer, n);
+    }
+}
+
+#if !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE)
+// With neither way to refuse SIGPIPE per send, it is ignored while any cluster is alive.
+static int gNumLiveClusters = 0;
+static struct sigaction gSavedPipeAction;
+#endif
+
+/* Keeps a send to a dead worker from raising SIGPIPE, which would end the coordinator. */
+static void refuseSigpipe(int fd) {
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void) fd;
+#endif
+}
+
+/*
+ * Workers are forked from the coordinator, which may be running other
+ * threads (the GUI thread, test timers). Only the forking thread exists in
+ * the child, so any lock another thread held at the fork stays held
+ * forever. The child therefore avoids everything that takes such locks:
+ * it reads its shard with open and read rather than iostreams, parses
+ * numbers with strtol, never calls error(), and writes with send. What it
+ * does use is the allocator, which glibc and the BSD libc re-initialize
+ * in the child, and the query evaluator, whose lazily built tables are
+ * built here in the parent first so the child never initializes them.
+ */
+ShardCluster::ShardCluster(string prefix, int numShards, const IndexOptions& options, int startupMs)
+    : _nextQueryId(1) {
+    if (numShards < 1) {
+        error("ShardCluster: need at least one shard");
+    }
+    {
+        CompiledIndex empty((Map<string, Set<string>>()));
+        compileQuery(empty, "the a", options);
+    }
+#if !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE)
+    if (gNumLiveClusters++ == 0) {
+        struct sigaction ignore = {};
+        ignore.sa_handler = SIG_IGN;
+        sigaction(SIGPIPE, &ignore, &gSavedPipeAction);
+    }
+#endif
+    cout.flush();   // or the children would flush copies of anything buffered
+    cerr.flush();
+    for (int shard = 0; shard < numShards; shard++) {
+        int ends[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+            error("ShardCluster: cannot create a socket for a worker");
+        }
+        refuseSigpipe(ends[0]);
+        refuseSigpipe(ends[1]);
+        string filename = shardFileName(prefix, shard);
+        pid_t pid = fork();
+        if (pid < 0) {
+            error("ShardCluster: cannot start a worker process");
+        }
+        if (pid == 0) {
+            // Only keep this worker's socket, so the others see EOF when the coordinator closes theirs.
+            close(ends[0]);
+            for (const Worker& worker : _workers) {
+                close(worker.fd);
+            }
+            bool loaded = false;
+            try {
+                loaded = serveShard(ends[1], filename, options);
+            } catch (...) {
+            }
+            _exit(loaded ? 0 : 1);   // skip the parent's atexit handlers and static destructors
+        }
+        close(ends[1]);
+        _workers.push_back({pid, ends[0], ""});
+    }
+
+    // Wait until every worker has loaded its shard; one that dies or is too slow is left out.
+    vector<Vector<string>> unused;
+    vector<bool> ready;
+    collect(0, startupMs, unused, ready);
+    for (int shard = 0; shard < numShards; shard++) {
+        if (!ready[shard]) retire(_workers[shard]);
+    }
+}
+
+ShardCluster::~ShardCluster() {
+    for (Worker& worker : _workers) {
+        retire(worker);
+    }
+#if !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE)
+    if (--gNumLiveClusters == 0) {
+        sigaction(SIGPIPE, &gSavedPipeAction, nullptr);
+    }
+#endif
+}
+
+int ShardCluster::workerPid(int shard) const {
+    return _workers[shard].pid;
+}
+
+/* Reads what is available from worker into its pending buffer; false at EOF or on error. */
+bool ShardCluster::receive(Worker& worker) {
+    char buffer[65536];
+    while (true) {
+        ssize_t n = read(worker.fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        worker.pending.append(buffer, n);
+        return true;
+    }
+}
+
+/*
+ * Closes the socket to a worker and ends the process. Workers only read
+ * their shard, so killing one loses nothing, and unlike waiting for it to
+ * see EOF this also ends a worker that is stuck or stopped.
+ */
+void ShardCluster::retire(Worker& worker) {
+    if (worker.fd >= 0) {
+        close(worker.fd);
+        worker.fd = -1;
+    }
+    if (worker.pid > 0) {
+        kill(worker.pid, SIGKILL);
+        waitpid(worker.pid, nullptr, 0);
+        worker.pid = -1;
+    }
+    worker.pending.clear();
+}
+
+/*
+ * Sends query to every live worker and collects the answers that arrive
+ * before the deadline into results, indexed by shard. Returns how many
+ * shards answered.
+ */
+int ShardCluster::scatterGather(const string& query, int limit, int deadlineMs, vector<Vector<string>>& results) {
+    long id = _nextQueryId++;
+    string flat = query;
+    replace(flat.begin(), flat.end(), '\n', ' ');
+    string request = integerToString(id) + "\t" + integerToString(limit) + "\t" + flat + "\n";
+    for (Worker& worker : _workers) {
+        if (worker.fd >= 0 && !sendAll(worker.fd, request)) retire(worker);
+    }
+    vector<bool> answered;
+    return collect(id, deadlineMs, results, answered);
+}
+
+/*
+ * Waits up to deadlineMs milliseconds for every live worker's response
+ * to query id, storing each shard's urls in results and whether it
+ * answered in answered. Responses to other ids are dropped, and a worker
+ * whose socket closes is retired. Returns how many shards answered.
+ */
+int ShardCluster::collect(long id, int deadlineMs, vector<Vector<string>>& results, vector<bool>& answered) {
+    results.assign(_workers.size(), Vector<string>());
+    answered.assign(_workers.size(), false);
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(deadlineMs);
+    int numAnswered = 0;
+    while (true) {
+        vector<pollfd> waiting;
+        vector<int> shards;
+        for (int shard = 0; shard < numShards(); shard++) {
+            if (_workers[shard].fd >= 0 && !answered[shard]) {
+                waiting.push_back({_workers[shard].fd, POLLIN, 0});
+                shards.push_back(shard);
+            }
+        }
+        long remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        if (waiting.empty() || remaining <= 0) break;
+        int ready = poll(waiting.data(), waiting.size(), remaining);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) break;
+
+        for (size_t i = 0; i < waiting.size(); i++) {
+            if (waiting[i].revents == 0) continue;
+            Worker& worker = _workers[shards[i]];
+            if (!receive(worker)) {
+                retire(worker);
+                continue;
+            }
+            long responseId;
+            Vector<string> urls;
+            while (takeResponse(worker.pending, responseId, urls)) {
+                if (responseId == id) {
+                    results[shards[i]] = urls;
+                    answered[shards[i]] = true;
+                    numAnswered++;
+                }
+            }
+        }
+    }
+    return numAnswered;
+}
+
+#else
+
+ShardCluster::ShardCluster(string, int, const IndexOptions&, int) : _nextQueryId(1) {
+    error("ShardCluster: worker processes need fork(), which this platform does not have");
+}
+
+ShardCluster::~ShardCluster() {}
+
+int ShardCluster::workerPid(int) const {
+    return -1;
+}
+
+bool ShardCluster::receive(Worker&) {
+    return false;
+}
+
+void ShardCluster::retire(Worker&) {}
+
+int ShardCluster::scatterGather(const string&, int, int, vector<Vector<string>>&) {
+    return 0;
+}
+
+int ShardCluster::collect(long, int, vector<Vector<string>>&, vector<bool>&) {
+    return 0;
+}
+
+#endif
+
+Set<string> ShardCluster::findQueryMatches(string query, int deadlineMs, int* numAnswered) {
+    vector<Vector<string>> results;
+    int answered = scatterGather(query, -1, deadlineMs, results);
+    if (numAnswered) *numAnswered = answered;
+    Set<string> matches;
+    for (const Vector<string>& urls : results) {
+        for (const string& url : urls) {
+            matches.add(url);
+        }
+    }
+    return matches;
+}
+
+Vector<string> ShardCluster::findTopMatches(string query, int k, int deadlineMs, int* numAnswered) {
+    if (k < 0) {
+        error("ShardCluster: k must not be negative");
+    }
+    vector<Vector<string>> results;
+    int answered = scatterGather(query, k, deadlineMs, results);
+    if (numAnswered) *numAnswered = answered;
+    vector<string> merged;
+    for (const Vector<string>& urls : results) {
+        merged.insert(merged.end(), urls.begin(), urls.end());
+    }
+    size_t keep = min(merged.size(), size_t(k));
+    partial_sort(merged.begin(), merged.begin() + keep, merged.end());
+    Vector<string> top;
+    for (size_t i = 0; i < keep; i++) {
+        top.add(merged[i]);
+    }
+    return top;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+static const string kShardPrefix = "res/_shard";
+
+static void deleteShardFiles(int numShards) {
+    for (int shard = 0; shard < numShards; shard++) {
+        deleteFile(shardFileName(kShardPrefix, shard));
+    }
+}
+
+STUDENT_TEST("buildShardedIndex splits the pages so the shards add up to the whole index") {
+    Map<string, Set<string>> whole;
+    int numPages = buildIndex("res/website.txt", whole);
+    EXPECT_EQUAL(buildShardedIndex("res/website.txt", 3, kShardPrefix), numPages);
+
+    Map<string, Set<string>> merged;
+    int total = 0;
+    for (int shard = 0; shard < 3; shard++) {
+        Map<string, Set<string>> index;
+        readShardFile(shardFileName(kShardPrefix, shard), index);
+        Set<string> urls;
+        for (const string& term : index) {
+            merged[term].unionWith(index[term]);
+            urls.unionWith(index[term]);
+        }
+        for (const string& url : urls) {
+            EXPECT_EQUAL(shardOf(url, 3), shard);
+        }
+        total += urls.size();
+    }
+    EXPECT_EQUAL(merged, whole);
+    EXPECT(total <= numPages);   // a page with no terms is in no shard's index
+    deleteShardFiles(3);
+    EXPECT_ERROR(buildShardedIndex("res/_missing.txt", 2, kShardPrefix));
+}
+
+#ifndef _WIN32
+
+STUDENT_TEST("ShardCluster answers queries exactly as the single index does") {
+    Map<string, Set<string>> whole;
+    buildIndex("res/website.txt", whole);
+    buildShardedIndex("res/website.txt", 3, kShardPrefix);
+    {
+        ShardCluster cluster(kShardPrefix, 3);
+        for (string query : {"citation", "style +grading", "cs106l template -qt", "the", "hippo", ""}) {
+            int numAnswered = 0;
+            EXPECT_EQUAL(cluster.findQueryMatches(query, 5000, &numAnswered), findQueryMatches(whole, query));
+            EXPECT_EQUAL(numAnswered, 3);
+
+            Vector<string> top = cluster.findTopMatches(query, 5, 5000);
+            Vector<string> expected;
+            for (const string& url : findQueryMatches(whole, query)) {
+                if (expected.size() < 5) expected.add(url);
+            }
+            EXPECT_EQUAL(top, expected);
+        }
+    }
+    deleteShardFiles(3);
+}
+
+STUDENT_TEST("ShardCluster leaves out a stalled or dead shard and recovers from a late one") {
+    Map<string, Set<string>> whole;
+    buildIndex("res/website.txt", whole);
+    buildShardedIndex("res/website.txt", 3, kShardPrefix);
+    {
+        ShardCluster cluster(kShardPrefix, 3);
+        Set<string> expected = findQueryMatches(whole, "the");
+
+        kill(cluster.workerPid(0), SIGSTOP);
+        int numAnswered = 0;
+        Set<string> partial = cluster.findQueryMatches("the", 200, &numAnswered);
+        EXPECT_EQUAL(numAnswered, 2);
+        EXPECT(partial.isSubsetOf(expected));
+        for (const string& url : partial) {
+            EXPECT(shardOf(url, 3) != 0);
+        }
+
+        // The late answer to "the" arrives first and must not be taken for this query's.
+        kill(cluster.workerPid(0), SIGCONT);
+        EXPECT_EQUAL(cluster.findQueryMatches("citation", 5000, &numAnswered), findQueryMatches(whole, "citation"));
+        EXPECT_EQUAL(numAnswered, 3);
+
+        kill(cluster.workerPid(1), SIGKILL);
+        partial = cluster.findQueryMatches("the", 5000, &numAnswered);
+        EXPECT_EQUAL(numAnswered, 2);
+        EXPECT_EQUAL(cluster.workerPid(1), -1);
+        EXPECT_EQUAL(cluster.findQueryMatches("the", 5000, &numAnswered), partial);
+    }
+    {
+        // A missing shard file kills that worker at startup.
+        deleteFile(shardFileName(kShardPrefix, 2));
+        ShardCluster cluster(kShardPrefix, 3);
+        int numAnswered = 0;
+        cluster.findQueryMatches("the", 5000, &numAnswered);
+        EXPECT_EQUAL(numAnswered, 2);
+    }
+    {
+        // Opening a FIFO blocks until a writer appears, so worker 1 never finishes loading
+        // and startup gives up on it at the deadline.
+        deleteFile(shardFileName(kShardPrefix, 1));
+        mkfifo(shardFileName(kShardPrefix, 1).c_str(), 0600);
+        ShardCluster cluster(kShardPrefix, 3, IndexOptions(), 300);
+        deleteFile(shardFileName(kShardPrefix, 1));
+        EXPECT(cluster.workerPid(0) > 0);
+        EXPECT_EQUAL(cluster.workerPid(1), -1);
+        int numAnswered = 0;
+        cluster.findQueryMatches("the", 5000, &numAnswered);
+        EXPECT_EQUAL(numAnswered, 1);
+    }
+    deleteShardFiles(3);
+}
+
+STUDENT_TEST("ShardCluster query time as the number of shards grows") {
+    for (int numShards : {1, 2, 4}) {
+        buildShardedIndex("res/website.txt", numShards, kShardPrefix);
+        {
+            ShardCluster cluster(kShardPrefix, numShards);
+            TIME_OPERATION(numShards, cluster.findQueryMatches("the -section", 5000));
+            TIME_OPERATION(numShards, cluster.findTopMatches("the -section", 10, 5000));
+        }
+        deleteShardFiles(numShards);
+    }
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * File: shardindex.h
+ * ------------------
+ * Defines a document-partitioned index: the pages of a database are split
+ * across a number of shards, each with its own index file, and queries
+ * are answered by worker processes, one per shard, whose results a
+ * coordinator merges. Because every page lives in exactly one shard and
+ * a query's +/- operators only ever look at one page's terms, the union
+ * of the shards' matches is exactly the match set of the whole index.
+ *
+ * Shard index file format: one line per term, in sorted order, holding
+ * the term and then the urls of its pages, all separated by tabs.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "map.h"
+#include "search.h"
+#include "set.h"
+#include "vector.h"
+
+/* The shardOf function returns the shard, 0 to numShards - 1, that holds url. */
+int shardOf(const std::string& url, int numShards);
+
+/* The shardFileName function returns the name of the index file of one shard. */
+std::string shardFileName(const std::string& prefix, int shard);
+
+/*
+ * The buildShardedIndex function splits the pages of dbfile across
+ * numShards shards and writes each shard's index to
+ * shardFileName(prefix, shard), analyzing text with options. Shards are
+ * built one at a time, so at most one shard's index is in memory. Returns
+ * the number of pages processed, or calls error() if dbfile cannot be
+ * read or a shard file cannot be written.
+ */
+int buildShardedIndex(std::string dbfile, int numShards, std::string prefix,
+                      const IndexOptions& options = IndexOptions());
+
+/* The writeShardFile function writes index in the shard index file format. */
+void writeShardFile(std::string filename, const Map<std::string, Set<std::string>>& index);
+
+/* The readShardFile function reads a shard index file into index. */
+void readShardFile(std::string filename, Map<std::string, Set<std::string>>& index);
+
+/*
+ * A ShardCluster starts one worker process per shard, each serving
+ * queries from its own shard's index file, and fans queries out to them
+ * over local sockets. Each query has a deadline: shards that have not
+ * answered by then are left out of that query's results, and their late
+ * answers are discarded when they arrive. A worker that dies is left out
+ * of every later query.
+ *
+ * The constructor waits up to startupMs milliseconds for the workers to
+ * load their shards. A worker that fails to load its shard or is still
+ * loading at the deadline is ended and left out, like one that dies
+ * later. Sends to a dead worker never raise SIGPIPE in the coordinator.
+ *
+ * Workers are created with fork(), so a ShardCluster needs a POSIX
+ * system; on Windows the constructor calls error().
+ */
+class ShardCluster {
+public:
+    ShardCluster(std::string prefix, int numShards, const IndexOptions& options = IndexOptions(),
+                 int startupMs = 10000);
+    ~ShardCluster();
+    ShardCluster(const ShardCluster&) = delete;
+    ShardCluster& operator=(const ShardCluster&) = delete;
+
+    int numShards() const {
+        return _workers.size();
+    }
+
+    /* Returns the process id of the worker for shard, or -1 if it has died. */
+    int workerPid(int shard) const;
+
+    /*
+     * Returns the union of the shards' matches for query, waiting at most
+     * deadlineMs milliseconds. Stores in numAnswered, if not null, how many
+     * shards' results are included.
+     */
+    Set<std::string> findQueryMatches(std::string query, int deadlineMs, int* numAnswered = nullptr);
+
+    /*
+     * Returns the first k matches for query in url order. Each shard sends
+     * only its own first k, so at most numShards * k urls are transferred.
+     */
+    Vector<std::string> findTopMatches(std::string query, int k, int deadlineMs, int* numAnswered = nullptr);
+
+private:
+    struct Worker {
+        int pid;
+        int fd;               // this end of the socket; -1 once the worker is gone
+        std::string pending;  // bytes received but not yet parsed
+    };
+
+    int scatterGather(const std::string& query, int limit, int deadlineMs, std::vector<Vector<std::string>>& results);
+    int collect(long id, int deadlineMs, std::vector<Vector<std::string>>& results, std::vector<bool>& answered);
+    bool receive(Worker& worker);
+    void retire(Worker& worker);
+
+    std::vector<Worker> _workers;
+    long _nextQueryId;
+};
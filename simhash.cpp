@@ -0,0 +1,262 @@
+/*
+ * File: simhash.cpp
+ * -----------------
+ * SimHash signatures and the banded bucket search. The bands are as
+ * equal in width as 64 bits allow. Each bucket lists only the first
+ * member of each group, so a page is compared against at most one
+ * representative per group that shares a band value with it.
+ */
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "error.h"
+#include "filelib.h"
+#include "map.h"
+#include "search.h"
+#include "set.h"
+#include "simhash.h"
+#include "strlib.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+/* FNV-1a followed by a 64-bit finalizer, so every bit depends on every character. */
+static uint64_t hashToken(const string& token) {
+    uint64_t h = 14695981039346656037ull;
+    for (char ch : token) {
+        h = (h ^ (unsigned char) ch) * 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    return h ^ (h >> 33);
+}
+
+uint64_t simHash(const Set<string>& tokens) {
+    int votes[64] = {0};
+    for (const string& token : tokens) {
+        uint64_t h = hashToken(token);
+        for (int bit = 0; bit < 64; bit++) {
+            votes[bit] += (h >> bit & 1) ? 1 : -1;
+        }
+    }
+    uint64_t signature = 0;
+    for (int bit = 0; bit < 64; bit++) {
+        if (votes[bit] > 0) signature |= uint64_t(1) << bit;
+    }
+    return signature;
+}
+
+int hammingDistance(uint64_t a, uint64_t b) {
+    uint64_t diff = a ^ b;
+    int count = 0;
+    for (; diff != 0; diff &= diff - 1) {
+        count++;
+    }
+    return count;
+}
+
+/* Returns the bits of signature from start up to (not including) end. */
+static uint64_t bandValue(uint64_t signature, int start, int end) {
+    int width = end - start;
+    return signature >> start & (width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1);
+}
+
+int findNearDuplicates(const Vector<uint64_t>& signatures, int maxDistance, Vector<int>& canonical) {
+    if (maxDistance < 0 || maxDistance > 63) {
+        error("findNearDuplicates: maxDistance must be from 0 to 63");
+    }
+    int numBands = maxDistance + 1;
+    vector<int> bandStart(numBands + 1);
+    for (int band = 0; band <= numBands; band++) {
+        bandStart[band] = band * 64 / numBands;
+    }
+
+    // One table per band, from band value to the group leaders having it
+    vector<unordered_map<uint64_t, vector<int>>> buckets(numBands);
+    canonical.clear();
+    int numGroups = 0;
+    for (int i = 0; i < signatures.size(); i++) {
+        uint64_t signature = signatures[i];
+        // Every band is checked: the earliest leader in range may only share a later band.
+        // Leaders are added in index order, so a bucket's first match is its smallest.
+        int leader = i;
+        for (int band = 0; band < numBands; band++) {
+            auto found = buckets[band].find(bandValue(signature, bandStart[band], bandStart[band + 1]));
+            if (found == buckets[band].end()) continue;
+            for (int other : found->second) {
+                if (other >= leader) break;
+                if (hammingDistance(signature, signatures[other]) <= maxDistance) {
+                    leader = other;
+                    break;
+                }
+            }
+        }
+        canonical.add(leader);
+        if (leader == i) {
+            numGroups++;
+            for (int band = 0; band < numBands; band++) {
+                buckets[band][bandValue(signature, bandStart[band], bandStart[band + 1])].push_back(i);
+            }
+        }
+    }
+    return numGroups;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("simHash is close for near-identical token sets and far for unrelated ones") {
+    Set<string> page;
+    for (int i = 0; i < 200; i++) page.add("word" + integerToString(i));
+    Set<string> variant = page;
+    variant.remove("word7");
+    variant.add("page2");
+    Set<string> other;
+    for (int i = 0; i < 200; i++) other.add("term" + integerToString(i));
+
+    EXPECT_EQUAL(simHash(page), simHash(page));
+    EXPECT(hammingDistance(simHash(page), simHash(variant)) <= 3);
+    EXPECT(hammingDistance(simHash(page), simHash(other)) > 10);
+    EXPECT_EQUAL(hammingDistance(0, ~uint64_t(0)), 64);
+}
+
+/* Returns what findNearDuplicates should fill canonical with, by comparing every pair. */
+static Vector<int> allPairsCanonical(const Vector<uint64_t>& signatures, int maxDistance) {
+    Vector<int> canonical;
+    for (int i = 0; i < signatures.size(); i++) {
+        int leader = i;
+        for (int j = 0; j < i && leader == i; j++) {
+            if (canonical[j] == j && hammingDistance(signatures[i], signatures[j]) <= maxDistance) leader = j;
+        }
+        canonical.add(leader);
+    }
+    return canonical;
+}
+
+STUDENT_TEST("findNearDuplicates groups signatures within the distance, whichever band matches") {
+    Vector<uint64_t> signatures = {0x0, 0x7, 0xF0000000000000F0ull, 0x8000000000000000ull, 0xF0000000000000F1ull,
+                                   0xFFFFFFFF00000000ull};
+    Vector<int> canonical;
+    EXPECT_EQUAL(findNearDuplicates(signatures, 3, canonical), 3);
+    EXPECT_EQUAL(canonical, {0, 0, 2, 0, 2, 5});
+    EXPECT_EQUAL(findNearDuplicates(signatures, 0, canonical), 6);
+    EXPECT_EQUAL(findNearDuplicates(signatures, 63, canonical), 1);
+    EXPECT_ERROR(findNearDuplicates(signatures, 64, canonical));
+
+    // Agrees with comparing every pair
+    mt19937_64 random(106);
+    Vector<uint64_t> many;
+    for (int i = 0; i < 300; i++) {
+        uint64_t base = random();
+        many.add(base);
+        many.add(base ^ (uint64_t(1) << (random() % 64)) ^ (uint64_t(1) << (random() % 64)));
+    }
+    findNearDuplicates(many, 2, canonical);
+    EXPECT_EQUAL(canonical, allPairsCanonical(many, 2));
+}
+
+STUDENT_TEST("findNearDuplicates picks the earliest leader in range, not the first band's") {
+    // With distance 2 the bands are bits 0-20, 21-41 and 42-63. The last
+    // signature is 2 bits from both leaders but shares only band 2 with
+    // leader 0 and band 0 with leader 1.
+    uint64_t bit0 = 1, bit21 = uint64_t(1) << 21, bit42 = uint64_t(1) << 42, bit43 = uint64_t(1) << 43;
+    Vector<uint64_t> signatures = {bit21 | bit42, bit0 | bit43, bit0 | bit42};
+    Vector<int> canonical;
+    EXPECT_EQUAL(findNearDuplicates(signatures, 2, canonical), 2);
+    EXPECT_EQUAL(canonical, {0, 1, 0});
+
+    // Tight clusters, so many signatures are in range of several leaders
+    mt19937_64 random(106);
+    for (int maxDistance : {2, 3, 6}) {
+        Vector<uint64_t> clustered;
+        for (int cluster = 0; cluster < 20; cluster++) {
+            uint64_t base = random();
+            for (int i = 0; i < 30; i++) {
+                uint64_t variant = base;
+                for (int flips = random() % (maxDistance + 2); flips > 0; flips--) {
+                    variant ^= uint64_t(1) << (random() % 64);
+                }
+                clustered.add(variant);
+            }
+        }
+        findNearDuplicates(clustered, maxDistance, canonical);
+        EXPECT_EQUAL(canonical, allPairsCanonical(clustered, maxDistance));
+    }
+}
+
+/*
+ * Writes a copy of res/website.txt to filename in which every third page
+ * also appears under a mirror url with a line of navigation text added,
+ * as crawls of mirrored sites do. Returns the number of mirrors.
+ */
+static int writeMirroredWebsite(const string& filename) {
+    ifstream in("res/website.txt");
+    ofstream out(filename);
+    string url, body;
+    int numMirrors = 0;
+    for (int i = 0; getline(in, url) && getline(in, body); i++) {
+        out << url << '\n' << body << '\n';
+        if (i % 3 == 0) {
+            out << url << "?mirror=1\n" << body << " Mirror page previous next\n";
+            numMirrors++;
+        }
+    }
+    return numMirrors;
+}
+
+STUDENT_TEST("buildIndex collapses near-duplicate pages to one canonical url") {
+    int numMirrors = writeMirroredWebsite("res/_mirrored.txt");
+    IndexOptions options;
+    options.removeNearDuplicates = true;
+    Map<string, Set<string>> plain, deduped;
+    Map<string, Set<string>> aliases;
+    int numPages = buildIndex("res/_mirrored.txt", plain);
+    EXPECT_EQUAL(buildIndex("res/_mirrored.txt", deduped, options, aliases), numPages);
+
+    Set<string> canonicalUrls;
+    long plainPostings = 0, dedupedPostings = 0;
+    for (const string& term : plain) plainPostings += plain[term].size();
+    for (const string& term : deduped) {
+        dedupedPostings += deduped[term].size();
+        canonicalUrls.unionWith(deduped[term]);
+    }
+    int numAliases = 0;
+    for (const string& url : aliases) {
+        EXPECT(canonicalUrls.contains(url));
+        for (const string& alias : aliases[url]) {
+            EXPECT_EQUAL(alias, url + "?mirror=1");
+            numAliases++;
+        }
+    }
+    EXPECT(numAliases >= numMirrors * 3 / 4);
+    EXPECT(canonicalUrls.size() <= numPages - numAliases);
+    EXPECT(dedupedPostings < plainPostings);
+
+    // A canonical page has the same terms in both indexes, so it matches the same queries
+    for (string query : {"citation", "style +grading", "cs106l template -qt", "the", "mirror"}) {
+        Set<string> expected = findQueryMatches(plain, query);
+        expected.intersect(canonicalUrls);
+        EXPECT_EQUAL(findQueryMatches(deduped, query), expected);
+    }
+    deleteFile("res/_mirrored.txt");
+}
+
+STUDENT_TEST("Query time with and without near-duplicate removal") {
+    writeMirroredWebsite("res/_mirrored.txt");
+    IndexOptions options;
+    options.removeNearDuplicates = true;
+    Map<string, Set<string>> plain, deduped;
+    TIME_OPERATION(1, buildIndex("res/_mirrored.txt", plain));
+    TIME_OPERATION(1, buildIndex("res/_mirrored.txt", deduped, options));
+    Set<string> plainMatches, dedupedMatches;
+    TIME_OPERATION(1, plainMatches = findQueryMatches(plain, "the a to of and"));
+    TIME_OPERATION(1, dedupedMatches = findQueryMatches(deduped, "the a to of and"));
+    EXPECT(dedupedMatches.isSubsetOf(plainMatches));
+    EXPECT(dedupedMatches.size() < plainMatches.size());
+    deleteFile("res/_mirrored.txt");
+}
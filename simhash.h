@@ -0,0 +1,37 @@
+/*
+ * File: simhash.h
+ * ---------------
+ * Defines near-duplicate detection for pages. Each page's token set is
+ * summarized by a 64-bit SimHash: similar sets give signatures that
+ * differ in few bits. Candidate pairs are found with banded
+ * locality-sensitive hashing. The signature is cut into maxDistance + 1
+ * bands, and two signatures within maxDistance bits of each other must
+ * agree exactly on at least one band. So only pages sharing a band bucket
+ * are ever compared, which keeps the search close to linear in the
+ * number of pages.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "set.h"
+#include "vector.h"
+
+/*
+ * The simHash function returns the SimHash of a set of tokens, with every
+ * token weighted equally.
+ */
+uint64_t simHash(const Set<std::string>& tokens);
+
+/* The hammingDistance function returns the number of bits in which a and b differ. */
+int hammingDistance(uint64_t a, uint64_t b);
+
+/*
+ * The findNearDuplicates function groups signatures that are within
+ * maxDistance bits (0 to 63) of an earlier group's first member, joining
+ * the earliest such group when there are several. It fills canonical so
+ * that canonical[i] is the index of the first signature of i's group,
+ * which is i itself for the first. Returns the number of groups.
+ */
+int findNearDuplicates(const Vector<uint64_t>& signatures, int maxDistance, Vector<int>& canonical);
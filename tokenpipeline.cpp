@@ -0,0 +1,386 @@
+/*
+ * File: tokenpipeline.cpp
+ * -----------------------
+ * The stop-word table, the Porter stemmer and the pipeline that chains
+ * them. The stemmer follows the structure of Porter's reference
+ * implementation: k is the index of the last letter of the word being
+ * stemmed and j marks the end of the stem when a suffix has matched.
+ */
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include "error.h"
+#include "tokenpipeline.h"
+#include "vector.h"
+#include "SimpleTest.h"
+using namespace std;
+
+
+static const char* const kStopWords[] = {
+    "a", "an", "and", "are", "as", "at", "be", "but", "by", "for", "if", "in", "into", "is", "it",
+    "no", "not", "of", "on", "or", "such", "that", "the", "their", "then", "there", "these", "they",
+    "this", "to", "was", "will", "with"
+};
+static const int kNumStopWords = sizeof(kStopWords) / sizeof(kStopWords[0]);
+static const uint32_t kStopTableSize = 128;   // power of two, about 4x the word count
+
+static uint32_t seededHash(const char* s, size_t length, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;   // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ (unsigned char) s[i]) * 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+/*
+ * The perfect-hash table: the seed is the first one found for which no
+ * two stop words share a slot. It is searched for once, on first use.
+ */
+struct StopWordTable {
+    uint32_t seed = 0;
+    signed char slot[kStopTableSize];
+
+    StopWordTable() {
+        for (;; seed++) {
+            memset(slot, -1, sizeof(slot));
+            bool collided = false;
+            for (int i = 0; i < kNumStopWords && !collided; i++) {
+                uint32_t h = seededHash(kStopWords[i], strlen(kStopWords[i]), seed) & (kStopTableSize - 1);
+                collided = slot[h] >= 0;
+                slot[h] = i;
+            }
+            if (!collided) return;
+        }
+    }
+};
+
+bool isStopWord(const char* token, size_t length) {
+    static const StopWordTable table;
+    int i = table.slot[seededHash(token, length, table.seed) & (kStopTableSize - 1)];
+    return i >= 0 && strlen(kStopWords[i]) == length && memcmp(kStopWords[i], token, length) == 0;
+}
+
+/* The state of one stemming operation on a word held in b[0..k]. */
+struct PorterStemmer {
+    char* b;
+    int k;
+    int j;
+
+    /* True if b[i] is a consonant; y is a consonant at the start or after a vowel. */
+    bool cons(int i) const {
+        switch (b[i]) {
+            case 'a': case 'e': case 'i': case 'o': case 'u': return false;
+            case 'y': return i == 0 || !cons(i - 1);
+            default: return true;
+        }
+    }
+
+    /* The number of vowel-consonant sequences in b[0..j]: the m of [C](VC)^m[V]. */
+    int m() const {
+        int n = 0;
+        int i = 0;
+        while (true) {
+            if (i > j) return n;
+            if (!cons(i)) break;
+            i++;
+        }
+        i++;
+        while (true) {
+            while (true) {
+                if (i > j) return n;
+                if (cons(i)) break;
+                i++;
+            }
+            i++;
+            n++;
+            while (true) {
+                if (i > j) return n;
+                if (!cons(i)) break;
+                i++;
+            }
+            i++;
+        }
+    }
+
+    bool vowelInStem() const {
+        for (int i = 0; i <= j; i++) {
+            if (!cons(i)) return true;
+        }
+        return false;
+    }
+
+    bool doubleConsonant(int i) const {
+        return i >= 1 && b[i] == b[i - 1] && cons(i);
+    }
+
+    /* True if b[i-2..i] is consonant-vowel-consonant and b[i] is not w, x or y. */
+    bool cvc(int i) const {
+        if (i < 2 || !cons(i) || cons(i - 1) || !cons(i - 2)) return false;
+        return b[i] != 'w' && b[i] != 'x' && b[i] != 'y';
+    }
+
+    /* True if b[0..k] ends with s, setting j to the end of the stem before it. */
+    bool ends(const char* s) {
+        int length = strlen(s);
+        if (s[length - 1] != b[k] || length > k + 1) return false;
+        if (memcmp(b + k - length + 1, s, length) != 0) return false;
+        j = k - length;
+        return true;
+    }
+
+    /* Replaces b[j+1..k] with s. Never lengthens the word past its original length. */
+    void setTo(const char* s) {
+        int length = strlen(s);
+        memcpy(b + j + 1, s, length);
+        k = j + length;
+    }
+
+    void replaceIfMeasured(const char* s) {
+        if (m() > 0) setTo(s);
+    }
+
+    /* Plurals and -ed or -ing. */
+    void step1ab() {
+        if (b[k] == 's') {
+            if (ends("sses")) {
+                k -= 2;
+            } else if (ends("ies")) {
+                setTo("i");
+            } else if (b[k - 1] != 's') {
+                k--;
+            }
+        }
+        if (ends("eed")) {
+            if (m() > 0) k--;
+        } else if ((ends("ed") || ends("ing")) && vowelInStem()) {
+            k = j;
+            if (ends("at")) {
+                setTo("ate");
+            } else if (ends("bl")) {
+                setTo("ble");
+            } else if (ends("iz")) {
+                setTo("ize");
+            } else if (doubleConsonant(k)) {
+                k--;
+                if (b[k] == 'l' || b[k] == 's' || b[k] == 'z') k++;
+            } else if (m() == 1 && cvc(k)) {
+                setTo("e");
+            }
+        }
+    }
+
+    /* Terminal y to i when there is another vowel in the stem. */
+    void step1c() {
+        if (ends("y") && vowelInStem()) b[k] = 'i';
+    }
+
+    /* Double suffixes to single ones, e.g. -ization to -ize. */
+    void step2() {
+        if (k < 1) return;
+        switch (b[k - 1]) {
+            case 'a':
+                if (ends("ational")) { replaceIfMeasured("ate"); break; }
+                if (ends("tional")) { replaceIfMeasured("tion"); break; }
+                break;
+            case 'c':
+                if (ends("enci")) { replaceIfMeasured("ence"); break; }
+                if (ends("anci")) { replaceIfMeasured("ance"); break; }
+                break;
+            case 'e':
+                if (ends("izer")) { replaceIfMeasured("ize"); break; }
+                break;
+            case 'l':
+                if (ends("bli")) { replaceIfMeasured("ble"); break; }
+                if (ends("alli")) { replaceIfMeasured("al"); break; }
+                if (ends("entli")) { replaceIfMeasured("ent"); break; }
+                if (ends("eli")) { replaceIfMeasured("e"); break; }
+                if (ends("ousli")) { replaceIfMeasured("ous"); break; }
+                break;
+            case 'o':
+                if (ends("ization")) { replaceIfMeasured("ize"); break; }
+                if (ends("ation")) { replaceIfMeasured("ate"); break; }
+                if (ends("ator")) { replaceIfMeasured("ate"); break; }
+                break;
+            case 's':
+                if (ends("alism")) { replaceIfMeasured("al"); break; }
+                if (ends("iveness")) { replaceIfMeasured("ive"); break; }
+                if (ends("fulness")) { replaceIfMeasured("ful"); break; }
+                if (ends("ousness")) { replaceIfMeasured("ous"); break; }
+                break;
+            case 't':
+                if (ends("aliti")) { replaceIfMeasured("al"); break; }
+                if (ends("iviti")) { replaceIfMeasured("ive"); break; }
+                if (ends("biliti")) { replaceIfMeasured("ble"); break; }
+                break;
+            case 'g':
+                if (ends("logi")) { replaceIfMeasured("log"); break; }
+                break;
+        }
+    }
+
+    /* -ic-, -full, -ness and similar. */
+    void step3() {
+        switch (b[k]) {
+            case 'e':
+                if (ends("icate")) { replaceIfMeasured("ic"); break; }
+                if (ends("ative")) { replaceIfMeasured(""); break; }
+                if (ends("alize")) { replaceIfMeasured("al"); break; }
+                break;
+            case 'i':
+                if (ends("iciti")) { replaceIfMeasured("ic"); break; }
+                break;
+            case 'l':
+                if (ends("ical")) { replaceIfMeasured("ic"); break; }
+                if (ends("ful")) { replaceIfMeasured(""); break; }
+                break;
+            case 's':
+                if (ends("ness")) { replaceIfMeasured(""); break; }
+                break;
+        }
+    }
+
+    /* Removes -ant, -ence and similar when the stem is long enough (m > 1). */
+    void step4() {
+        if (k < 1) return;
+        switch (b[k - 1]) {
+            case 'a': if (ends("al")) break; return;
+            case 'c': if (ends("ance") || ends("ence")) break; return;
+            case 'e': if (ends("er")) break; return;
+            case 'i': if (ends("ic")) break; return;
+            case 'l': if (ends("able") || ends("ible")) break; return;
+            case 'n': if (ends("ant") || ends("ement") || ends("ment") || ends("ent")) break; return;
+            case 'o':
+                if (ends("ion") && j >= 0 && (b[j] == 's' || b[j] == 't')) break;
+                if (ends("ou")) break;
+                return;
+            case 's': if (ends("ism")) break; return;
+            case 't': if (ends("ate") || ends("iti")) break; return;
+            case 'u': if (ends("ous")) break; return;
+            case 'v': if (ends("ive")) break; return;
+            case 'z': if (ends("ize")) break; return;
+            default: return;
+        }
+        if (m() > 1) k = j;
+    }
+
+    /* Removes a final -e, and -ll to -l, when the stem is long enough. */
+    void step5() {
+        j = k;
+        if (b[k] == 'e') {
+            int a = m();
+            if (a > 1 || (a == 1 && !cvc(k - 1))) k--;
+        }
+        if (b[k] == 'l' && doubleConsonant(k) && m() > 1) k--;
+    }
+};
+
+size_t porterStem(char* buffer, size_t length) {
+    if (length <= 2) return length;
+    PorterStemmer stemmer = {buffer, int(length) - 1, 0};
+    stemmer.step1ab();
+    if (stemmer.k > 0) {
+        stemmer.step1c();
+        stemmer.step2();
+        stemmer.step3();
+        stemmer.step4();
+        stemmer.step5();
+    }
+    return stemmer.k + 1;
+}
+
+TokenPipeline::TokenPipeline(bool removeStopWords, bool stem, int ngramSize)
+    : _removeStopWords(removeStopWords), _stem(stem), _ngramSize(ngramSize), _numRecent(0) {
+    if (ngramSize < 1) {
+        error("TokenPipeline: n-gram size must be at least 1");
+    }
+    _recent.resize(ngramSize);
+    for (string& buffer : _recent) {
+        buffer.reserve(64);
+    }
+    _gram.reserve(64 * ngramSize);
+}
+
+bool TokenPipeline::analyzeWord(const char* word, size_t length, TokenView& term) {
+    // Clean straight into the next slot of the ring of recent terms.
+    string& buffer = _recent[_numRecent % _ngramSize];
+    buffer.resize(length);   // within capacity after the first few words
+    size_t n = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char ch = tolower((unsigned char) word[i]);
+        if (ch < 128 && isalnum(ch)) buffer[n++] = ch;
+    }
+    if (n == 0) return false;
+    if (_removeStopWords && isStopWord(buffer.data(), n)) return false;
+    if (_stem) n = porterStem(&buffer[0], n);
+    buffer.resize(n);
+    _numRecent++;
+    term = {buffer.data(), n};
+    return true;
+}
+
+bool TokenPipeline::ngram(int size, TokenView& term) {
+    if (size > _ngramSize || size > _numRecent) return false;
+    _gram.clear();
+    for (int i = _numRecent - size; i < _numRecent; i++) {
+        if (!_gram.empty()) _gram += ' ';
+        _gram += _recent[i % _ngramSize];
+    }
+    term = {_gram.data(), _gram.size()};
+    return true;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+static string stem(string word) {
+    word.resize(porterStem(&word[0], word.size()));
+    return word;
+}
+
+STUDENT_TEST("isStopWord recognizes exactly the stop words") {
+    for (int i = 0; i < kNumStopWords; i++) {
+        EXPECT(isStopWord(kStopWords[i], strlen(kStopWords[i])));
+    }
+    for (string word : {"", "fish", "ant", "thee", "then1", "wit", "i", "tha", "withs"}) {
+        EXPECT(!isStopWord(word.data(), word.size()));
+    }
+}
+
+STUDENT_TEST("porterStem matches Porter's published examples") {
+    EXPECT_EQUAL(stem("caresses"), "caress");
+    EXPECT_EQUAL(stem("ponies"), "poni");
+    EXPECT_EQUAL(stem("cats"), "cat");
+    EXPECT_EQUAL(stem("feed"), "feed");
+    EXPECT_EQUAL(stem("agreed"), "agre");
+    EXPECT_EQUAL(stem("plastered"), "plaster");
+    EXPECT_EQUAL(stem("motoring"), "motor");
+    EXPECT_EQUAL(stem("sing"), "sing");
+    EXPECT_EQUAL(stem("conflated"), "conflat");
+    EXPECT_EQUAL(stem("hopping"), "hop");
+    EXPECT_EQUAL(stem("falling"), "fall");
+    EXPECT_EQUAL(stem("filing"), "file");
+    EXPECT_EQUAL(stem("happy"), "happi");
+    EXPECT_EQUAL(stem("relational"), "relat");
+    EXPECT_EQUAL(stem("generalization"), "gener");
+    EXPECT_EQUAL(stem("connections"), "connect");
+    EXPECT_EQUAL(stem("electrical"), "electr");
+    EXPECT_EQUAL(stem("adjustable"), "adjust");
+    EXPECT_EQUAL(stem("controlling"), "control");
+    EXPECT_EQUAL(stem("is"), "is");
+}
+
+STUDENT_TEST("TokenPipeline stages: cleaning only, stop words, stemming and n-grams") {
+    string text = "The  Cats *and* the HATS, running";
+    auto collect = [&](TokenPipeline& pipeline) {
+        Vector<string> terms;
+        pipeline.run(text.data(), text.size(), [&](TokenView term) { terms.add(term.toString()); });
+        return terms;
+    };
+    TokenPipeline plain;
+    EXPECT_EQUAL(collect(plain), {"the", "cats", "and", "the", "hats", "running"});
+    TokenPipeline filtered(true, true);
+    EXPECT_EQUAL(collect(filtered), {"cat", "hat", "run"});
+    TokenPipeline bigrams(true, true, 2);
+    EXPECT_EQUAL(collect(bigrams), {"cat", "hat", "cat hat", "run", "hat run"});
+    EXPECT_ERROR(TokenPipeline(false, false, 0));
+}
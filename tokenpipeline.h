@@ -0,0 +1,119 @@
+/*
+ * File: tokenpipeline.h
+ * ---------------------
+ * Defines the text analysis applied to page text at index time and to
+ * query terms at search time. The stages run in this order:
+ *     split on spaces -> clean (as cleanToken) -> stop-word filter -> stem -> n-grams
+ * Every stage works in place on buffers owned by the pipeline, so
+ * analyzing a token allocates nothing once the buffers have grown to fit
+ * the longest token seen.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ * A TokenView refers to characters owned by someone else, here the
+ * pipeline's buffers. It is only valid until the pipeline moves on to the
+ * next token.
+ */
+struct TokenView {
+    const char* data;
+    size_t length;
+
+    std::string toString() const {
+        return std::string(data, length);
+    }
+};
+
+/*
+ * The isStopWord function returns true if the cleaned (lowercase,
+ * alphanumeric) token is one of the common English words the pipeline can
+ * drop: a, an, and, are, as, at, be, but, by, for, if, in, into, is, it,
+ * no, not, of, on, or, such, that, the, their, then, there, these, they,
+ * this, to, was, will, with. The lookup is a perfect hash: one hash, one
+ * probe and one comparison.
+ */
+bool isStopWord(const char* token, size_t length);
+
+/*
+ * The porterStem function reduces the lowercase word in buffer[0..length)
+ * to its stem in place, using Porter's algorithm (1980), and returns the
+ * new length. Words of two letters or fewer are left alone.
+ */
+size_t porterStem(char* buffer, size_t length);
+
+/*
+ * The TokenPipeline class runs the analysis stages with the given
+ * settings. With removeStopWords false, stem false and ngramSize 1 it
+ * produces exactly the tokens of gatherTokens.
+ *
+ * With ngramSize n > 1, each term is followed by the word n-grams ending
+ * at it, for sizes 2 to n. They are joined by single spaces, so
+ * "red fish blue" with n = 2 gives "red", "red fish", "fish", "fish blue"
+ * and "blue". N-grams are formed after stop words are dropped.
+ */
+class TokenPipeline {
+public:
+    TokenPipeline(bool removeStopWords = false, bool stem = false, int ngramSize = 1);
+
+    /* Calls emit(TokenView) for every term of text, in order and with repeats. */
+    template <typename Emit>
+    void run(const char* text, size_t length, Emit emit) {
+        _numRecent = 0;
+        size_t start = 0;
+        for (size_t i = 0; i <= length; i++) {
+            if (i == length || text[i] == ' ') {
+                TokenView term;
+                if (analyzeWord(text + start, i - start, term)) {
+                    emit(term);
+                    emitNgrams(emit);
+                }
+                start = i + 1;
+            }
+        }
+    }
+
+    /*
+     * Runs the clean, stop-word and stem stages on one word. Stores the
+     * resulting term in term and returns true, or returns false if the
+     * word was dropped (nothing left after cleaning, or a stop word).
+     * The term is also remembered as the latest word for n-grams.
+     */
+    bool analyzeWord(const char* word, size_t length, TokenView& term);
+
+    /* Forgets the remembered words, so the next n-gram cannot span this point. */
+    void resetNgrams() {
+        _numRecent = 0;
+    }
+
+    /*
+     * Stores in term the n-gram of the last size words given to
+     * analyzeWord, and returns true; or returns false if fewer words have
+     * been seen since the last reset.
+     */
+    bool ngram(int size, TokenView& term);
+
+    int ngramSize() const {
+        return _ngramSize;
+    }
+
+private:
+    template <typename Emit>
+    void emitNgrams(Emit& emit) {
+        TokenView gram;
+        for (int size = 2; size <= _ngramSize && ngram(size, gram); size++) {
+            emit(gram);
+        }
+    }
+
+    bool _removeStopWords;
+    bool _stem;
+    int _ngramSize;
+    std::vector<std::string> _recent;   // ring of the last ngramSize terms
+    int _numRecent;                     // total terms since the last reset
+    std::string _gram;
+};